@@ -0,0 +1,33 @@
+#ifndef TOLITO_AUR_H
+#define TOLITO_AUR_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "tolito-repoindex.h"
+
+// Package metadata returned by the AUR RPC info endpoint
+struct AURPackage {
+    std::string name;
+    std::string version;
+    std::string packageBase;               // Git repository to clone for this package
+    long long lastModified = 0;            // Unix time of the last upload to the package base
+    std::vector<std::string> depends;
+    std::vector<std::string> makeDepends;  // Includes checkdepends, which makepkg -s also installs
+};
+
+// Query AUR metadata for all 'names' using as few multi-arg RPC requests as possible.
+// Packages missing from the AUR are simply absent from the result.
+std::map<std::string, AURPackage> queryAURInfo(const std::vector<std::string>& names);
+
+// Index of every AUR package name, built from the AUR's packages.gz list.
+// The list is refreshed with a conditional GET once per run and kept in
+// ~/.cache/tolito/aur; lookups are binary searches in the mmap'd index.
+// Not open if the list was never downloaded.
+const RepoIndex& loadAURIndex();
+
+// Whether 'name' is an AUR package, according to the index
+bool packageExistsInAUR(const std::string& name);
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef TOLITO_BUILD_H
+#define TOLITO_BUILD_H
+
+#include <string>
+#include <vector>
+
+#include "tolito-config.h"
+
+// One PKGBUILD to build
+struct BuildTask {
+    std::string name;                    // Package name, used for messages and the log file
+    std::string cloneUrl;                // Cloned into 'dir' first (may be empty)
+    std::string dir;                     // Directory containing the PKGBUILD
+    std::string logFile;                 // Build output when running concurrently
+    std::vector<std::string> artifacts;  // Built package files (filled by runBuilds)
+    std::string cacheKey;                // Build cache key of the inputs, empty if not cacheable
+    std::vector<size_t> dependsOn;       // Tasks that must be built and installed first
+    bool ok = false;
+};
+
+// Package files already built in 'dir' that belong to 'name' (debug packages excluded)
+std::vector<std::string> findBuiltPackages(const std::string& dir, const std::string& name);
+
+// Group tasks into waves whose members only depend on earlier waves, so each
+// wave can be built concurrently. Tasks on a dependency cycle, or depending on
+// one, are left out and returned in 'cyclic'.
+std::vector<std::vector<size_t>> buildWaves(const std::vector<BuildTask>& tasks, std::vector<size_t>& cyclic);
+
+// Clone and build the given tasks, up to config.buildJobs at a time. Packages
+// whose inputs match an earlier build come from the build cache instead. With more
+// than one build running, output goes to per-package logs under ~/tolito/logs
+// and makepkg's dependency installs are serialized. Nothing is installed here.
+// Returns true if every task produced a package.
+bool runBuilds(const std::vector<BuildTask*>& tasks, const Config& config);
+
+#endif
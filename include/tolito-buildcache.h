@@ -0,0 +1,24 @@
+#ifndef TOLITO_BUILDCACHE_H
+#define TOLITO_BUILDCACHE_H
+
+#include <string>
+#include <vector>
+
+// Cache key for the PKGBUILD in 'dir': SHA-256 over every file git tracks there
+// (PKGBUILD, patches, install scripts...) and the makepkg.conf/environment
+// settings that change the output. Empty if the package can't be cached
+// (VCS packages, whose version is only known after building).
+std::string buildCacheKey(const std::string& dir, const std::string& name);
+
+// Artifacts cached under 'key' that belong to 'name'; empty on a miss.
+// A hit marks the entry as recently used.
+std::vector<std::string> lookupBuildCache(const std::string& key, const std::string& name);
+
+// Move exactly the package files a build produced into the cache entry 'key'
+// and return their cached paths. If the entry cannot be written the original
+// files are left in place and returned unchanged. Least recently used entries
+// are evicted to keep the cache under 'maxBytes' (0 = no limit).
+std::vector<std::string> storeBuildCache(const std::string& key, const std::vector<std::string>& files,
+                                         unsigned long long maxBytes);
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef TOLITO_CONFIG_H
+#define TOLITO_CONFIG_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+// Repository configuration
+struct Repository {
+    std::string name;
+    std::vector<std::string> servers;
+    std::string siglevel;
+    std::string includePath;
+};
+
+// Update rules configuration
+struct UpdateRule {
+    std::string main;
+    std::string alternative;
+    std::string fallback;
+    bool getFromAUR = false;
+    bool getFromChaotic = false;
+    bool getFromCurated = false;
+};
+
+// Configuration structure to hold settings
+struct Config {
+    bool askBeforeAUR = true;
+    bool warnAboutAUR = true;
+    bool askBeforeSwitchSources = false;
+    std::map<std::string, UpdateRule> updateRules;
+    std::map<std::string, Repository> repositories;
+    // Misc options
+    bool iLoveCandy = false;
+    bool disableDownloadTimeout = false;
+    bool color = true;
+    int parallelUpdateChecks = 8;
+    int parallelDownloads = 5;
+    int downloadSegments = 1;   // Ranges per large package (1 = no splitting)
+    int buildJobs = 4;          // Concurrent makepkg runs for multi-package installs
+    int buildCacheSize = 4096;  // MiB kept in ~/.cache/tolito/builds (0 = unlimited)
+};
+
+// Parse ~/.config/tolito/tolito.conf (writing the default file if missing).
+// Called once at startup; the result is passed by reference to every module.
+Config readConfig();
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef TOLITO_CURATED_H
+#define TOLITO_CURATED_H
+
+#include <string>
+#include <vector>
+
+#include "tolito-syncdb.h"
+
+// Session over the curated monorepo (viper-pkgbuilds) at ~/tolito/viper-pkgbuilds.
+// The repository is cloned or fetched at most once per run and read straight
+// from git objects; the working tree is only touched to check out packages
+// that are about to be built. Lookups go through a manifest parsed from every
+// package's .SRCINFO, cached in ~/.cache/tolito/curated.idx and rebuilt only
+// when the fetched tree changes. All functions are thread-safe.
+
+// Path of the local clone, cloning it (sparse, blobless) on first use; empty on failure
+std::string curatedRepoPath();
+
+// Fetch the newest commit once per run (later calls are no-ops)
+bool refreshCuratedRepo();
+
+// Whether the package has a directory at the current commit
+bool curatedPackageExists(const std::string& name);
+
+// Manifest entry for 'name': version is the full [epoch:]pkgver-pkgrel (empty if
+// it can't be known without running the PKGBUILD), depends also lists make and
+// check dependencies, directory is the package's directory in the repository
+bool findCuratedPackage(const std::string& name, PackageInfo& out);
+
+// Tree id of the package's directory at the current commit; it only changes
+// when something in that directory does. Empty if there is no such package.
+std::string curatedPackageTree(const std::string& name);
+
+// Add the package directories to the sparse-checkout cone in a single call
+bool checkoutCuratedPackages(const std::vector<std::string>& names);
+
+#endif
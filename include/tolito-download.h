@@ -0,0 +1,30 @@
+#ifndef TOLITO_DOWNLOAD_H
+#define TOLITO_DOWNLOAD_H
+
+#include <string>
+#include <vector>
+
+#include "tolito-config.h"
+
+// One file to fetch; 'urls' are tried in order (one per ranked mirror)
+struct DownloadJob {
+    std::string repo;                 // Repository for mirror statistics (may be empty)
+    std::vector<std::string> mirrors; // Mirror template per url, for statistics
+    std::vector<std::string> urls;
+    std::string output;
+    std::string displayName;
+    unsigned long long size = 0;      // Expected size if known; enables segmented downloads
+    std::string sha256;               // Expected SHA-256 if known; the file is rejected on mismatch
+    bool ok = false;                  // Set once the file is complete on disk
+};
+
+// Fetch all jobs concurrently (up to config.parallelDownloads at a time) with
+// pacman-style progress bars. Data is written to '<output>.part' and renamed on
+// completion; interrupted transfers resume with a Range request on the same or
+// next mirror, also across runs. Large files of known size are split into
+// config.downloadSegments ranges pulled from different mirrors at once.
+// The SHA-256 is computed as the data streams to disk, so a complete file is
+// accepted or rejected without reading it back. Returns true if every job succeeded.
+bool runDownloads(std::vector<DownloadJob>& jobs, const Config& config);
+
+#endif
@@ -2,14 +2,33 @@
 #define TOLITO_INSTALL_H
 
 #include <string>
+#include <vector>
+
+#include "tolito-config.h"
 
 // Clones, builds and installs a PKGBUILD identified by 'spec'
-int installPkg(const std::string& spec);
+int installPkg(const std::string& spec, const Config& config);
+
+// Install several packages: sources are chosen (and prompts answered) up front,
+// builds run concurrently and all artifacts go into one pacman transaction.
+// Returns one result per spec: 0=failure (including a declined pacman prompt), 1=success,
+// 2=declined the AUR prompt, 3=already installed
+std::vector<int> installPkgs(const std::vector<std::string>& specs, const Config& config);
+
+// A package to install from a source the caller already chose:
+// "Curated", "AUR" or the name of a configured repository
+struct InstallTarget {
+    std::string name;
+    std::string source;
+};
 
-// Install package from repository only (for -Sr flag)
-int installPkgFromRepo(const std::string& spec);
+// (Re)install 'targets' from their given sources without prompting for a source,
+// e.g. to apply updates; otherwise works like installPkgs.
+// Returns one result per target: 0=failure (including a declined pacman prompt), 1=success
+std::vector<int> installTargets(const std::vector<InstallTarget>& targets, const Config& config);
 
-// Remove package from source tracking
-void removePackageSource(const std::string& pkgName);
+// Install packages from repositories only (for -Sr flag); all downloads run
+// concurrently. Returns one result per spec: 0=failure, 1=success, 3=skipped
+std::vector<int> installPkgsFromRepo(const std::vector<std::string>& specs, const Config& config);
 
 #endif
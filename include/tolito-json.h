@@ -0,0 +1,29 @@
+#ifndef TOLITO_JSON_H
+#define TOLITO_JSON_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// Minimal JSON document model for AUR RPC replies and tolito's own state files
+struct JsonValue {
+    enum class Type { Null, Bool, Number, String, Array, Object };
+
+    Type type = Type::Null;
+    bool boolean = false;
+    double number = 0;
+    std::string string;
+    std::vector<JsonValue> array;
+    std::vector<std::pair<std::string, JsonValue>> object;
+
+    // Member lookup for objects; nullptr if missing or not an object
+    const JsonValue* find(const std::string& key) const;
+};
+
+// Parse 'text' into 'out'; returns false on malformed input
+bool parseJson(const std::string& text, JsonValue& out);
+
+// 's' as a quoted JSON string literal
+std::string jsonQuote(const std::string& s);
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef TOLITO_LOCALDB_H
+#define TOLITO_LOCALDB_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// An installed package, as recorded in <dbpath>/local/<name>-<version>/desc
+struct LocalPackage {
+    std::string name;
+    std::string version;
+    std::string description;
+    std::string url;
+    std::string arch;
+    std::string packager;
+    long long buildDate = 0;
+    long long installDate = 0;
+    unsigned long long installedSize = 0; // %SIZE%, bytes
+    bool asDependency = false;            // %REASON% 1
+    std::vector<std::string> licenses;
+    std::vector<std::string> groups;
+    std::vector<std::string> depends;
+    std::vector<std::string> optDepends;
+    std::vector<std::string> provides;
+    std::vector<std::string> conflicts;
+    std::vector<std::string> replaces;
+    std::vector<std::string> validation;
+};
+
+// pacman's local database, read in-process. It is loaded on first use and
+// shared by every module; TOLITO_DBPATH overrides /var/lib/pacman (e.g. to
+// point at a fixture). All functions are thread-safe.
+
+bool isInstalled(const std::string& name);
+
+// Installed version, empty if not installed
+std::string installedVersion(const std::string& name);
+
+bool findLocalPackage(const std::string& name, LocalPackage& out);
+
+// Snapshot of every installed package by name
+std::shared_ptr<const std::map<std::string, LocalPackage>> localPackages();
+
+// Forget what was read; call after a pacman transaction changed the database
+void invalidateLocalDatabase();
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef TOLITO_MIRROR_H
+#define TOLITO_MIRROR_H
+
+#include <string>
+#include <vector>
+
+// Parse a pacman mirrorlist and return its Server entries in order
+std::vector<std::string> parseMirrorlist(const std::string& path);
+
+// Reorder mirrors best first (don't remove any). Rankings persist per repository in
+// ~/.cache/tolito/mirrors/; mirrors are probed concurrently only when the list has
+// new entries, and a stale ranking is refreshed in the background.
+std::vector<std::string> selectBestMirrors(const std::vector<std::string>& mirrors, const std::string& repo, const std::string& arch);
+
+// Feed the outcome of a real transfer from 'mirror' back into its ranking.
+// Only the in-memory ranking changes; call saveMirrorRankings() after a batch.
+void recordMirrorTransfer(const std::string& repo, const std::string& mirror, bool ok, double bytes = 0, double seconds = 0);
+
+// Write every ranking with transfers recorded since it was last saved
+void saveMirrorRankings();
+
+#endif
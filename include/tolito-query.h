@@ -3,7 +3,8 @@
 
 #include <string>
 
-void queryPkg(const std::string& pkg);
-void showInfo(const std::string& pkg);
+// -Q and -Qi from the local database; false if 'pkg' is not installed
+bool queryPkg(const std::string& pkg);
+bool showInfo(const std::string& pkg);
 
 #endif
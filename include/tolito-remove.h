@@ -2,7 +2,10 @@
 #define TOLITO_REMOVE_H
 
 #include <string>
+#include <vector>
 
-bool removePkg(const std::string& pkg);
+// Remove all installed 'pkgs' in one 'pacman -Rns' transaction.
+// Returns one result per package: 0=failure (including a declined pacman prompt), 1=success
+std::vector<int> removePkgs(const std::vector<std::string>& pkgs);
 
 #endif
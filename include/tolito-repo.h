@@ -0,0 +1,37 @@
+#ifndef TOLITO_REPO_H
+#define TOLITO_REPO_H
+
+#include <string>
+#include <vector>
+
+#include "tolito-config.h"
+#include "tolito-repoindex.h"
+
+// Machine architecture used for $arch in mirror URLs
+std::string getSystemArch();
+
+// Substitute $repo and $arch in a mirror URL
+std::string replaceRepoVars(const std::string& url, const std::string& repo, const std::string& arch);
+
+// Servers for a repository: its mirrorlist (ranked fastest first) or configured Servers
+std::vector<std::string> getRepoServers(const Repository& repo);
+
+// Download 'url' to 'file' only if it changed since our copy (ETag and
+// If-Modified-Since; 'file' keeps the server's timestamp, the ETag goes to
+// '<file>.etag'). Returns: 0=failure, 1=downloaded, 2=not modified
+int fetchIfModified(const std::string& url, const std::string& file);
+
+// Refresh the repository database (conditionally) and open its index.
+// Opened once per run; safe to call from several threads.
+const RepoIndex& loadRepoIndex(const Repository& repo, bool silent = false);
+
+// Identifies the copy of the repository database the index was opened from:
+// the server's ETag, or its size and timestamp if it sent none. Empty if the
+// database could not be loaded.
+std::string repoDatabaseMarker(const Repository& repo);
+
+// Lookups against the shared repository index
+bool packageExistsInRepo(const std::string& pkgName, const Repository& repo);
+bool findRepoPackage(const std::string& pkgName, const Repository& repo, PackageInfo& out);
+
+#endif
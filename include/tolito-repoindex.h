@@ -0,0 +1,56 @@
+#ifndef TOLITO_REPOINDEX_H
+#define TOLITO_REPOINDEX_H
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <string_view>
+
+#include "tolito-syncdb.h"
+
+struct RepoIndexHeader;
+struct RepoIndexRecord;
+
+// Read-only view of a repository index file (<repo>.idx): a fixed-size record
+// array sorted by package name followed by a string table, mapped with mmap.
+class RepoIndex {
+public:
+    RepoIndex() = default;
+    ~RepoIndex();
+    RepoIndex(RepoIndex&& other) noexcept;
+    RepoIndex& operator=(RepoIndex&& other) noexcept;
+    RepoIndex(const RepoIndex&) = delete;
+    RepoIndex& operator=(const RepoIndex&) = delete;
+
+    // Map an index file; returns false if it is missing or malformed
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return base_ != nullptr; }
+
+    // Identifies the database the index was built from (see writeRepoIndex)
+    std::string_view stamp() const;
+    size_t size() const;
+
+    // Binary search by package name
+    bool contains(std::string_view name) const;
+    bool find(std::string_view name, PackageInfo& out) const;
+
+private:
+    const RepoIndexRecord* lookup(std::string_view name) const;
+    std::string_view str(unsigned offset, unsigned length) const;
+
+    void* base_ = nullptr;
+    size_t length_ = 0;
+    const RepoIndexHeader* header_ = nullptr;
+    const RepoIndexRecord* records_ = nullptr;
+    const char* strings_ = nullptr;
+};
+
+// Write an index for 'packages' to 'path' atomically, tagged with 'stamp'
+bool writeRepoIndex(const std::string& path, const std::map<std::string, PackageInfo>& packages, const std::string& stamp);
+
+// Open the index next to 'dbFile' (<repo>.db -> <repo>.idx), rebuilding it first
+// if it is missing or was built from a different copy of the database
+bool openRepoIndex(const std::string& dbFile, RepoIndex& index);
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef TOLITO_SHA256_H
+#define TOLITO_SHA256_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Incremental SHA-256 (FIPS 180-4)
+class Sha256 {
+public:
+    Sha256();
+
+    void update(const void* data, size_t length);
+    void update(std::string_view data) { update(data.data(), data.size()); }
+
+    // Finish the digest and return it as 64 lowercase hex characters.
+    // The object must not be updated afterwards.
+    std::string hexDigest();
+
+private:
+    uint32_t state_[8];
+    uint64_t length_ = 0;     // Total bytes hashed
+    uint8_t buffer_[64];
+    size_t buffered_ = 0;
+};
+
+// SHA-256 of a whole file as hex, or an empty string if it can't be read
+std::string sha256File(const std::string& path);
+
+#endif
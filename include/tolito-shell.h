@@ -0,0 +1,10 @@
+#ifndef TOLITO_SHELL_H
+#define TOLITO_SHELL_H
+
+#include <string>
+
+// 's' as a single shell word: wrapped in single quotes, embedded quotes escaped.
+// Use for every value spliced into a command run through system() or popen().
+std::string shellQuote(const std::string& s);
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef TOLITO_SOURCES_H
+#define TOLITO_SOURCES_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// What tolito knows about a package it installed
+struct PackageRecord {
+    std::string source;      // "AUR", "Curated" or a repository name
+    std::string version;     // Version installed by tolito
+    std::string buildKey;    // Build cache key of the inputs it was built from (may be empty)
+    long long installedAt = 0; // Unix time of the install
+};
+
+// Store of installed package records (~/.config/tolito/package_sources.json).
+// The file is read once per process and changes are applied in memory; each
+// batch is written back atomically (temporary file + rename) under a lock,
+// after replaying it on the file's current contents so overlapping runs keep
+// each other's changes. Files from older versions ("name": "source") are read
+// as records with only a source. All functions are thread-safe.
+
+bool findPackageRecord(const std::string& name, PackageRecord& out);
+
+// Every record, sorted by package name
+std::vector<std::pair<std::string, PackageRecord>> packageRecords();
+
+// Add or replace records and write the store once
+bool recordPackages(const std::vector<std::pair<std::string, PackageRecord>>& records);
+
+// Drop records and write the store once
+bool forgetPackages(const std::vector<std::string>& names);
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef TOLITO_SYNCDB_H
+#define TOLITO_SYNCDB_H
+
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Package information structure
+struct PackageInfo {
+    std::string name;
+    std::string version;
+    std::string description;
+    std::vector<std::string> depends;
+    std::string filename;
+    unsigned long long compressedSize = 0; // %CSIZE%, 0 if unknown
+    std::string sha256;                    // %SHA256SUM% of the package file, empty if unknown
+    std::string directory;                 // Curated manifest only: the package's directory in the repository
+};
+
+// Parse the contents of a sync database 'desc' entry
+PackageInfo parsePackageDesc(std::string_view desc);
+
+// Read a pacman sync database (<repo>.db) in memory: decompress it and walk the
+// tar stream, parsing every */desc entry into 'packages'. Returns false if the
+// file could not be read or decompressed.
+bool readSyncDatabase(const std::string& dbFile, std::map<std::string, PackageInfo>& packages);
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef TOLITO_TRANSACTION_H
+#define TOLITO_TRANSACTION_H
+
+#include <string>
+#include <vector>
+
+// Everything one pacman commit should change. Callers collect all built or
+// downloaded artifacts first so pacman loads its database, checks conflicts
+// and runs hooks once instead of once per package.
+struct Transaction {
+    std::vector<std::string> files;       // Package files installed explicitly
+    std::vector<std::string> depFiles;    // Package files installed as dependencies
+    std::vector<std::string> removals;    // Package names removed with their unneeded dependencies
+};
+
+// Package name of a package file (name-pkgver-pkgrel-arch.pkg.tar.*)
+std::string packageFileName(const std::string& pkgFile);
+
+// Commit 'tx': one 'pacman -Rns' for the removals, then one 'pacman -U' for all
+// files, with a single prompt each. Returns: 0=failure (including a declined
+// prompt, which pacman doesn't report differently), 1=success
+int commitTransaction(const Transaction& tx);
+
+#endif
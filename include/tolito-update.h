@@ -4,10 +4,28 @@
 #include <string>
 #include <vector>
 
+#include "tolito-config.h"
+
+// An update found by checkUpdates
+struct PackageUpdate {
+    std::string name;
+    std::string currentVersion;
+    std::string newVersion;
+    std::string source;   // Update rule source offering it: CURATED, AUR or CHAOTIC
+    int result = -1;      // Set by applyUpdates: 0=failure, 1=success
+};
+
 // Update a single package or all packages
-int updatePkg(const std::string& spec = "");
+int updatePkg(const Config& config, const std::string& spec = "");
 
 // Check for updates across all sources
-std::vector<std::string> checkUpdates();
+std::vector<PackageUpdate> checkUpdates(const Config& config);
+
+// Install 'updates' from their sources in this process, sharing one install
+// run (indexes, builds, a single pacman transaction), and set each result
+void applyUpdates(std::vector<PackageUpdate>& updates, const Config& config);
+
+// "name old -> new (from SOURCE)"
+std::string describeUpdate(const PackageUpdate& update);
 
 #endif
\ No newline at end of file
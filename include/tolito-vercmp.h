@@ -0,0 +1,120 @@
+#ifndef TOLITO_VERCMP_H
+#define TOLITO_VERCMP_H
+
+#include <string_view>
+
+// Native port of libalpm's alpm_pkg_vercmp() (the algorithm behind `vercmp`).
+// Everything is constexpr so versions can be compared without spawning processes.
+
+constexpr bool vercmpIsDigit(char c) { return c >= '0' && c <= '9'; }
+constexpr bool vercmpIsAlpha(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); }
+constexpr bool vercmpIsAlnum(char c) { return vercmpIsDigit(c) || vercmpIsAlpha(c); }
+
+// Compare two version segments (no epoch/pkgrel), like rpmvercmp() in libalpm
+constexpr int rpmvercmp(std::string_view a, std::string_view b) {
+    if (a == b) return 0;
+
+    size_t one = 0, two = 0;
+    while (one < a.size() && two < b.size()) {
+        size_t sep1 = one, sep2 = two;
+        while (one < a.size() && !vercmpIsAlnum(a[one])) ++one;
+        while (two < b.size() && !vercmpIsAlnum(b[two])) ++two;
+
+        if (one == a.size() || two == b.size()) break;
+
+        // A longer run of separators wins
+        if (one - sep1 != two - sep2) {
+            return (one - sep1) < (two - sep2) ? -1 : 1;
+        }
+
+        // Grab the next completely numeric or completely alphabetic segment
+        size_t end1 = one, end2 = two;
+        bool isnum = vercmpIsDigit(a[one]);
+        if (isnum) {
+            while (end1 < a.size() && vercmpIsDigit(a[end1])) ++end1;
+            while (end2 < b.size() && vercmpIsDigit(b[end2])) ++end2;
+        } else {
+            while (end1 < a.size() && vercmpIsAlpha(a[end1])) ++end1;
+            while (end2 < b.size() && vercmpIsAlpha(b[end2])) ++end2;
+        }
+
+        // Segments of different types: numeric is newer than alpha
+        if (two == end2) return isnum ? 1 : -1;
+
+        std::string_view seg1 = a.substr(one, end1 - one);
+        std::string_view seg2 = b.substr(two, end2 - two);
+        if (isnum) {
+            while (!seg1.empty() && seg1.front() == '0') seg1.remove_prefix(1);
+            while (!seg2.empty() && seg2.front() == '0') seg2.remove_prefix(1);
+
+            // Whichever number has more digits wins
+            if (seg1.size() != seg2.size()) return seg1.size() > seg2.size() ? 1 : -1;
+        }
+
+        int rc = seg1.compare(seg2);
+        if (rc != 0) return rc < 0 ? -1 : 1;
+
+        one = end1;
+        two = end2;
+    }
+
+    if (one == a.size() && two == b.size()) return 0;
+
+    // The remaining string wins unless it starts with an alpha segment ("1.0a" < "1.0")
+    if ((one == a.size() && !vercmpIsAlpha(b[two])) || (one < a.size() && vercmpIsAlpha(a[one]))) {
+        return -1;
+    }
+    return 1;
+}
+
+// Split "epoch:pkgver-pkgrel" into its parts; a missing epoch reads as "0"
+struct VersionParts {
+    std::string_view epoch;
+    std::string_view version;
+    std::string_view release;
+    bool hasRelease = false;
+};
+
+constexpr VersionParts parseVersion(std::string_view evr) {
+    VersionParts parts;
+
+    size_t s = 0;
+    while (s < evr.size() && vercmpIsDigit(evr[s])) ++s;
+
+    size_t start = 0;
+    if (s < evr.size() && evr[s] == ':') {
+        parts.epoch = s == 0 ? std::string_view("0") : evr.substr(0, s);
+        start = s + 1;
+    } else {
+        parts.epoch = "0";
+    }
+
+    size_t dash = evr.rfind('-');
+    if (dash != std::string_view::npos && dash >= start) {
+        parts.version = evr.substr(start, dash - start);
+        parts.release = evr.substr(dash + 1);
+        parts.hasRelease = true;
+    } else {
+        parts.version = evr.substr(start);
+    }
+    return parts;
+}
+
+// Compare full package versions: <0 if a is older, 0 if equal, >0 if a is newer
+constexpr int compareVersions(std::string_view a, std::string_view b) {
+    if (a == b) return 0;
+
+    VersionParts va = parseVersion(a);
+    VersionParts vb = parseVersion(b);
+
+    int ret = rpmvercmp(va.epoch, vb.epoch);
+    if (ret == 0) {
+        ret = rpmvercmp(va.version, vb.version);
+        if (ret == 0 && va.hasRelease && vb.hasRelease) {
+            ret = rpmvercmp(va.release, vb.release);
+        }
+    }
+    return ret;
+}
+
+#endif
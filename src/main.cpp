@@ -2,7 +2,9 @@
 #include <cstdlib>
 #include <string>
 #include <vector>
+#include <curl/curl.h>
 
+#include "tolito-config.h"
 #include "tolito-install.h"
 #include "tolito-remove.h"
 #include "tolito-query.h"
@@ -16,6 +18,9 @@
 #define RESET    "\033[0m"
 
 int main(int argc, char* argv[]) {
+    // libcurl's global state is not thread-safe to set up lazily; do it before any worker starts
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
     if (argc < 2) {
         std::cerr << "Usage: tolito <option> [pkg-name1] [pkg-name2] ...\n"
                   << "Options:\n"
@@ -24,6 +29,7 @@ int main(int argc, char* argv[]) {
                   << " -Syu        Update all packages\n"
                   << " -Su <pkg>   Update specific package\n"
                   << " -R  <pkg>   Remove package(s)\n"
+                  << " -Q  <pkg>   Show installed version\n"
                   << " -Qi <pkg>   Show package info\n"
                   << " clean       Clear build cache\n";
         return 1;
@@ -36,12 +42,15 @@ int main(int argc, char* argv[]) {
         return 0;
     }
 
+    // Parse tolito.conf once; every module works from this copy
+    const Config config = readConfig();
+
     if (option == "-Syu") {
-        return updatePkg(""); // Update all packages
+        return updatePkg(config); // Update all packages
     }
 
     if (option == "-Su" && argc >= 3) {
-        return updatePkg(argv[2]); // Update specific package
+        return updatePkg(config, argv[2]); // Update specific package
     }
 
     if (argc < 3) {
@@ -55,22 +64,26 @@ int main(int argc, char* argv[]) {
     std::vector<std::string> alreadyInstalledPkgs;
     int successCount = 0;
 
+    // Installs and removals are resolved together so each is one pacman transaction
+    std::vector<int> installResults;
+    if (option == "-S") {
+        installResults = installPkgs(std::vector<std::string>(argv + 2, argv + argc), config);
+    } else if (option == "-Sr") {
+        installResults = installPkgsFromRepo(std::vector<std::string>(argv + 2, argv + argc), config);
+    } else if (option == "-R") {
+        installResults = removePkgs(std::vector<std::string>(argv + 2, argv + argc));
+    }
+
     for (int i = 2; i < argc; ++i) {
         std::string pkg = argv[i];
         int result = 0; // 0 = failure, 1 = success, 2 = declined, 3 = already installed
 
-        if (option == "-S") {
-            result = installPkg(pkg);
-        } else if (option == "-Sr") {
-            result = installPkgFromRepo(pkg);
-        } else if (option == "-R") {
-            result = removePkg(pkg) ? 1 : 0;
+        if (option == "-S" || option == "-Sr" || option == "-R") {
+            result = installResults[i - 2];
         } else if (option == "-Q") {
-            std::system(("pacman -Q " + pkg).c_str());
-            result = 1;
+            result = queryPkg(pkg) ? 1 : 0;
         } else if (option == "-Qi") {
-            showInfo(pkg);
-            result = 1; // Info display usually treated as success
+            result = showInfo(pkg) ? 1 : 0;
         } else {
             std::cerr << RED << "[!] Invalid option: " << option << RESET << "\n";
             return 2;
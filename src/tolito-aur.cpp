@@ -0,0 +1,200 @@
+#include "tolito-aur.h"
+#include "tolito-json.h"
+#include "tolito-repo.h"
+
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <curl/curl.h>
+#include <zlib.h>
+
+namespace fs = std::filesystem;
+
+static constexpr char AUR_RPC[] = "https://aur.archlinux.org/rpc/?v=5&type=info";
+static constexpr char AUR_PACKAGES[] = "https://aur.archlinux.org/packages.gz";
+
+// The AUR rejects request URIs longer than ~4400 bytes
+static constexpr size_t MAX_RPC_URL = 4000;
+
+// ANSI colors
+static constexpr char RED[]    = "\033[31m";
+static constexpr char RESET[]  = "\033[0m";
+
+static size_t appendToString(char* ptr, size_t size, size_t nmemb, void* userdata) {
+    static_cast<std::string*>(userdata)->append(ptr, size * nmemb);
+    return size * nmemb;
+}
+
+// Append the strings of a JSON array (absent fields are fine)
+static void appendStrings(const JsonValue* array, std::vector<std::string>& out) {
+    if (!array || array->type != JsonValue::Type::Array) return;
+    for (const auto& item : array->array) {
+        if (item.type == JsonValue::Type::String) {
+            out.push_back(item.string);
+        }
+    }
+}
+
+// Perform a single RPC request and merge its results
+static bool fetchAURChunk(CURL* curl, const std::string& url, std::map<std::string, AURPackage>& out) {
+    std::string body;
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, appendToString);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &body);
+
+    if (curl_easy_perform(curl) != CURLE_OK) {
+        return false;
+    }
+
+    JsonValue reply;
+    if (!parseJson(body, reply)) {
+        return false;
+    }
+
+    const JsonValue* results = reply.find("results");
+    if (!results || results->type != JsonValue::Type::Array) {
+        return false;
+    }
+
+    for (const auto& entry : results->array) {
+        const JsonValue* name = entry.find("Name");
+        const JsonValue* version = entry.find("Version");
+        if (!name || !version) continue;
+
+        AURPackage pkg;
+        pkg.name = name->string;
+        pkg.version = version->string;
+        const JsonValue* base = entry.find("PackageBase");
+        pkg.packageBase = base ? base->string : pkg.name;
+        const JsonValue* modified = entry.find("LastModified");
+        if (modified && modified->type == JsonValue::Type::Number) pkg.lastModified = (long long)modified->number;
+        appendStrings(entry.find("Depends"), pkg.depends);
+        appendStrings(entry.find("MakeDepends"), pkg.makeDepends);
+        appendStrings(entry.find("CheckDepends"), pkg.makeDepends);
+        out[pkg.name] = std::move(pkg);
+    }
+    return true;
+}
+
+std::map<std::string, AURPackage> queryAURInfo(const std::vector<std::string>& names) {
+    std::map<std::string, AURPackage> packages;
+    if (names.empty()) return packages;
+
+    CURL* curl = curl_easy_init();
+    if (!curl) return packages;
+
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 10L);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 60L);
+    curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+    curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+
+    // Pack as many arg[] parameters into each request as the URL limit allows;
+    // the same handle keeps the TLS connection alive between chunks
+    std::string url = AUR_RPC;
+    size_t argsInUrl = 0;
+    auto flush = [&]() {
+        if (argsInUrl == 0) return;
+        if (!fetchAURChunk(curl, url, packages)) {
+            std::cerr << RED << "[!] AUR RPC request failed" << RESET << "\n";
+        }
+        url = AUR_RPC;
+        argsInUrl = 0;
+    };
+
+    for (const auto& name : names) {
+        char* escaped = curl_easy_escape(curl, name.c_str(), static_cast<int>(name.size()));
+        if (!escaped) continue;
+        std::string arg = "&arg[]=" + std::string(escaped);
+        curl_free(escaped);
+
+        if (url.size() + arg.size() > MAX_RPC_URL) {
+            flush();
+        }
+        url += arg;
+        ++argsInUrl;
+    }
+    flush();
+
+    curl_easy_cleanup(curl);
+    return packages;
+}
+
+// Package names from the gzipped list, one per line
+static bool readPackageList(const std::string& file, std::map<std::string, PackageInfo>& packages) {
+    gzFile gz = gzopen(file.c_str(), "rb");
+    if (!gz) return false;
+
+    std::string data;
+    char buf[1 << 16];
+    int n;
+    while ((n = gzread(gz, buf, sizeof(buf))) > 0) {
+        data.append(buf, n);
+    }
+    bool ok = n == 0;
+    gzclose(gz);
+    if (!ok) return false;
+
+    size_t pos = 0;
+    while (pos < data.size()) {
+        size_t eol = data.find('\n', pos);
+        if (eol == std::string::npos) eol = data.size();
+        std::string name = data.substr(pos, eol - pos);
+        pos = eol + 1;
+        if (name.empty() || name[0] == '#') continue;
+        packages[name].name = name;
+    }
+    return !packages.empty();
+}
+
+// Size and mtime of the list, which keeps the server's timestamp
+static std::string listStamp(const std::string& file) {
+    std::error_code ec;
+    auto size = fs::file_size(file, ec);
+    if (ec) return "";
+    auto mtime = fs::last_write_time(file, ec);
+    if (ec) return "";
+    return std::to_string(size) + ":" + std::to_string(mtime.time_since_epoch().count());
+}
+
+static std::mutex aurIndexMutex;
+static RepoIndex aurIndex;
+static bool aurIndexLoaded = false;
+
+const RepoIndex& loadAURIndex() {
+    std::lock_guard<std::mutex> lock(aurIndexMutex);
+    if (aurIndexLoaded) return aurIndex;
+    aurIndexLoaded = true;
+
+    const char* home = std::getenv("HOME");
+    fs::path cacheDir = fs::path(home ? home : "/tmp") / ".cache" / "tolito" / "aur";
+    std::error_code ec;
+    fs::create_directories(cacheDir, ec);
+    std::string listFile = (cacheDir / "packages.gz").string();
+    std::string indexFile = (cacheDir / "packages.idx").string();
+
+    // Offline, the last list we got is still better than asking per package
+    fetchIfModified(AUR_PACKAGES, listFile);
+
+    std::string stamp = listStamp(listFile);
+    if (stamp.empty()) {
+        aurIndex.open(indexFile);
+        return aurIndex;
+    }
+    if (aurIndex.open(indexFile) && aurIndex.stamp() == stamp) {
+        return aurIndex;
+    }
+
+    std::map<std::string, PackageInfo> packages;
+    if (!readPackageList(listFile, packages) || !writeRepoIndex(indexFile, packages, stamp)) {
+        aurIndex.close();
+        return aurIndex;
+    }
+    aurIndex.open(indexFile);
+    return aurIndex;
+}
+
+bool packageExistsInAUR(const std::string& name) {
+    return loadAURIndex().contains(name);
+}
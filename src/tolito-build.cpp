@@ -0,0 +1,398 @@
+#include "tolito-build.h"
+#include "tolito-key.h"
+#include "tolito-buildcache.h"
+#include "tolito-sha256.h"
+#include "tolito-shell.h"
+
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <regex>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+// ANSI colors
+static constexpr char RED[]    = "\033[31m";
+static constexpr char GREEN[]  = "\033[32m";
+static constexpr char YELLOW[] = "\033[33m";
+static constexpr char RESET[]  = "\033[0m";
+
+// Serializes console output and PGP key imports between workers
+static std::mutex outputMutex;
+static std::mutex keyMutex;
+
+static int runShell(const std::string& cmd) {
+    int r = std::system(cmd.c_str());
+    return (r == -1 ? -1 : WEXITSTATUS(r));
+}
+
+static bool isPackageFile(const std::string& file) {
+    return file.find(".pkg.tar.") != std::string::npos &&
+           !(file.size() > 4 && file.compare(file.size() - 4, 4, ".sig") == 0);
+}
+
+// The package files among 'paths' that belong to 'name' (debug packages excluded)
+static std::vector<std::string> selectPackages(const std::vector<std::string>& paths, const std::string& name) {
+    std::vector<std::string> all, own;
+    for (const auto& path : paths) {
+        std::string file = fs::path(path).filename().string();
+        if (!isPackageFile(file) || file.rfind(name + "-debug-", 0) == 0) continue;
+        all.push_back(path);
+        if (file.rfind(name + "-", 0) == 0) {
+            own.push_back(path);
+        }
+    }
+    // Fall back to everything when the directory name isn't the pkgname (e.g. URL clones)
+    std::vector<std::string>& result = own.empty() ? all : own;
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+std::vector<std::string> findBuiltPackages(const std::string& dir, const std::string& name) {
+    std::vector<std::string> paths;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(dir, ec)) {
+        paths.push_back(entry.path().string());
+    }
+    return selectPackages(paths, name);
+}
+
+// Package files left in 'dir' by earlier builds; makepkg refuses to overwrite
+// them and they must never be mistaken for this run's output
+static void removeOldPackages(const std::string& dir) {
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(dir, ec)) {
+        if (entry.path().filename().string().find(".pkg.tar.") != std::string::npos) {
+            fs::remove(entry.path(), ec);
+        }
+    }
+}
+
+// The files this build produced, as named by 'makepkg --packagelist' (which
+// reflects a pkgver() update made while building), limited to those that exist
+static std::vector<std::string> builtPackageList(const BuildTask& task) {
+    std::vector<std::string> paths;
+    FILE* pipe = popen(("cd " + shellQuote(task.dir) + " && makepkg --packagelist 2>/dev/null").c_str(), "r");
+    if (!pipe) return paths;
+    char buf[4096];
+    while (fgets(buf, sizeof(buf), pipe)) {
+        std::string path = buf;
+        path.erase(path.find_last_not_of(" \r\n") + 1);
+        std::error_code ec;
+        if (!path.empty() && fs::is_regular_file(path, ec)) paths.push_back(path);
+    }
+    pclose(pipe);
+    return selectPackages(paths, task.name);
+}
+
+// makepkg calls $PACMAN (through sudo) to install dependencies; concurrent builds
+// would race for pacman's database lock, so route them through flock
+static std::string serialPacmanWrapper() {
+    const char* home = std::getenv("HOME");
+    if (!home) return "";
+    fs::path dir = fs::path(home) / ".cache" / "tolito" / "bin";
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    fs::path wrapper = dir / "pacman-serial";
+
+    std::ofstream out(wrapper);
+    if (!out) return "";
+    out << "#!/bin/sh\n"
+        << "exec flock " << shellQuote((dir / "pacman.lock").string()) << " pacman \"$@\"\n";
+    out.close();
+    fs::permissions(wrapper, fs::perms::owner_all | fs::perms::group_read | fs::perms::group_exec |
+                    fs::perms::others_read | fs::perms::others_exec, ec);
+    return ec ? "" : wrapper.string();
+}
+
+// Logged makepkg runs have no terminal to ask for a sudo password, and each
+// would prompt on its own; authenticate once and keep the timestamp fresh
+// until the pool is done
+struct SudoKeepAlive {
+    std::mutex mutex;
+    std::condition_variable stop;
+    bool done = false;
+    std::thread worker;
+
+    bool start() {
+        if (geteuid() == 0) return true;
+        if (runShell("sudo -v") != 0) return false;
+        worker = std::thread([this]() {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (!stop.wait_for(lock, std::chrono::seconds(60), [this]() { return done; })) {
+                runShell("sudo -n -v >/dev/null 2>&1");
+            }
+        });
+        return true;
+    }
+
+    ~SudoKeepAlive() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            done = true;
+        }
+        stop.notify_all();
+        if (worker.joinable()) worker.join();
+    }
+};
+
+// Missing PGP key reported by makepkg, if any
+static std::string findMissingKey(const std::string& output) {
+    std::regex re(R"(unknown public key ([0-9A-F]+))", std::regex::icase);
+    std::smatch m;
+    if (std::regex_search(output, m, re) && m.size() >= 2) {
+        return m[1].str();
+    }
+    return "";
+}
+
+// Run makepkg in the task directory, importing a missing PGP key once per key
+static bool buildPackage(const BuildTask& task, bool logged, const std::string& pacman, const std::string& prevKey = "") {
+    std::string buildCmd = "cd " + shellQuote(task.dir) + " && ";
+    if (logged) {
+        if (!pacman.empty()) buildCmd += "PACMAN=" + shellQuote(pacman) + " ";
+        buildCmd += "makepkg -s --noconfirm >> " + shellQuote(task.logFile) + " 2>&1";
+    } else {
+        buildCmd += "makepkg -s";
+        std::cout << YELLOW << "[~] makepkg -s" << RESET << "\n";
+    }
+
+    // Earlier attempts stay in the log; only this attempt's output is searched
+    std::error_code ec;
+    std::uintmax_t logStart = logged ? fs::file_size(task.logFile, ec) : 0;
+    if (ec) logStart = 0;
+
+    int buildRc = runShell(buildCmd);
+    if (buildRc == 0) return true;
+    if (buildRc == 2) return false;
+
+    // Check for PGP key issues
+    std::string output;
+    if (logged) {
+        std::ifstream log(task.logFile);
+        log.seekg(static_cast<std::streamoff>(logStart));
+        output.assign(std::istreambuf_iterator<char>(log), std::istreambuf_iterator<char>());
+    } else {
+        FILE* pipe = popen(("cd " + shellQuote(task.dir) + " && makepkg --nobuild 2>&1").c_str(), "r");
+        if (pipe) {
+            char buf[256];
+            while (fgets(buf, sizeof(buf), pipe)) {
+                output += buf;
+            }
+            pclose(pipe);
+        }
+    }
+
+    std::string keyId = findMissingKey(output);
+    if (keyId.empty() || keyId == prevKey) return false;
+    {
+        std::lock_guard<std::mutex> lock(keyMutex);
+        std::cout << YELLOW << "[*] Missing PGP key " << keyId << ", importing..." << RESET << "\n";
+        if (!fetchAndTrustgKey(keyId)) return false;
+    }
+    return buildPackage(task, logged, pacman, keyId);
+}
+
+// Bare mirror of 'url' under ~/.cache/tolito/git, named after the repository
+// plus a hash of the url so different hosts never share one
+static fs::path mirrorPath(const std::string& url) {
+    const char* home = std::getenv("HOME");
+    std::string name = fs::path(url).filename().string();
+    if (name.size() > 4 && name.compare(name.size() - 4, 4, ".git") == 0) name.resize(name.size() - 4);
+    Sha256 hash;
+    hash.update(url);
+    return fs::path(home ? home : "/tmp") / ".cache" / "tolito" / "git" / (name + "-" + hash.hexDigest().substr(0, 12) + ".git");
+}
+
+// Whether 'dir' is a worktree of 'mirror'
+static bool isWorktreeOf(const fs::path& dir, const fs::path& mirror) {
+    std::ifstream in(dir / ".git");
+    std::string line;
+    return std::getline(in, line) && line.rfind("gitdir: " + (mirror / "worktrees").string() + "/", 0) == 0;
+}
+
+// Bring task.dir to the newest commit of task.cloneUrl: the bare mirror is
+// cloned once and then fetched incrementally, and task.dir is a worktree of it
+// that is moved to the fetched commit in place (untracked files such as
+// downloaded sources stay for makepkg to reuse)
+static bool checkoutFromMirror(const BuildTask& task, bool logged) {
+    fs::path mirror = mirrorPath(task.cloneUrl);
+    std::string quiet = logged ? " >> " + shellQuote(task.logFile) + " 2>&1" : " >/dev/null 2>&1";
+    std::string git = "git -C " + shellQuote(mirror.string()) + " ";
+
+    std::error_code ec;
+    if (fs::exists(mirror / "HEAD", ec)) {
+        if (!logged) std::cout << GREEN << "[*] Fetching " << task.cloneUrl << RESET << "\n";
+        if (runShell(git + "fetch --quiet --prune origin" + quiet) != 0) return false;
+    } else {
+        if (!logged) std::cout << GREEN << "[*] Cloning " << task.cloneUrl << RESET << "\n";
+        fs::create_directories(mirror.parent_path(), ec);
+        fs::remove_all(mirror, ec);
+        std::string cloneCmd = "git clone --quiet --mirror " + shellQuote(task.cloneUrl) + " " + shellQuote(mirror.string());
+        if (runShell(cloneCmd + quiet) != 0) {
+            fs::remove_all(mirror, ec);
+            return false;
+        }
+    }
+
+    std::string commit;
+    FILE* pipe = popen((git + "rev-parse --verify --quiet HEAD").c_str(), "r");
+    if (pipe) {
+        char buf[128];
+        if (fgets(buf, sizeof(buf), pipe)) commit = buf;
+        pclose(pipe);
+        commit.erase(commit.find_last_not_of(" \n") + 1);
+    }
+    if (commit.empty()) return false;
+
+    if (isWorktreeOf(task.dir, mirror)) {
+        return runShell("git -C " + shellQuote(task.dir) + " checkout --quiet --force --detach " + commit + quiet) == 0;
+    }
+
+    // A plain clone from older versions, or a worktree that was deleted
+    fs::remove_all(task.dir, ec);
+    runShell(git + "worktree prune" + quiet);
+    return runShell(git + "worktree add --quiet --force --detach " + shellQuote(task.dir) + " " + commit + quiet) == 0;
+}
+
+// Check out (if needed) and build one task, reusing a cached build of identical inputs
+static void runBuild(BuildTask& task, bool logged, const std::string& pacman, const Config& config) {
+    if (logged) {
+        std::remove(task.logFile.c_str());
+    }
+
+    if (!task.cloneUrl.empty()) {
+        if (!checkoutFromMirror(task, logged)) {
+            std::lock_guard<std::mutex> lock(outputMutex);
+            std::cerr << RED << "[!] Could not fetch " << task.cloneUrl << " for " << task.name << RESET << "\n";
+            return;
+        }
+    }
+
+    std::string key = buildCacheKey(task.dir, task.name);
+    task.cacheKey = key;
+    task.artifacts = lookupBuildCache(key, task.name);
+    if (!task.artifacts.empty()) {
+        std::lock_guard<std::mutex> lock(outputMutex);
+        std::cout << YELLOW << "[*] " << task.name << " unchanged since its last build, using cached package" << RESET << "\n";
+        task.ok = true;
+        return;
+    }
+
+    if (logged) {
+        std::lock_guard<std::mutex> lock(outputMutex);
+        std::cout << YELLOW << "[~] Building " << task.name << " (log: " << task.logFile << ")" << RESET << "\n";
+    }
+
+    removeOldPackages(task.dir);
+    if (buildPackage(task, logged, pacman)) {
+        unsigned long long maxBytes = static_cast<unsigned long long>(config.buildCacheSize) * 1024 * 1024;
+        std::vector<std::string> built = builtPackageList(task);
+        task.artifacts = key.empty() || built.empty() ? built : storeBuildCache(key, built, maxBytes);
+    }
+    task.ok = !task.artifacts.empty();
+
+    std::lock_guard<std::mutex> lock(outputMutex);
+    if (task.ok) {
+        std::cout << GREEN << "[✓] Built " << task.name << RESET << "\n";
+    } else if (logged) {
+        std::cerr << RED << "[!] Build of " << task.name << " failed, see " << task.logFile << RESET << "\n";
+    } else {
+        std::cerr << RED << "[!] Build of " << task.name << " failed" << RESET << "\n";
+    }
+}
+
+std::vector<std::vector<size_t>> buildWaves(const std::vector<BuildTask>& tasks, std::vector<size_t>& cyclic) {
+    // Kahn's algorithm, one level at a time
+    std::vector<size_t> pending(tasks.size());
+    std::vector<std::vector<size_t>> dependents(tasks.size());
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        for (size_t dep : tasks[i].dependsOn) {
+            if (dep >= tasks.size() || dep == i) continue;
+            ++pending[i];
+            dependents[dep].push_back(i);
+        }
+    }
+
+    std::vector<std::vector<size_t>> waves;
+    std::vector<size_t> ready;
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        if (pending[i] == 0) ready.push_back(i);
+    }
+    size_t placed = 0;
+    while (!ready.empty()) {
+        std::vector<size_t> nextReady;
+        for (size_t i : ready) {
+            for (size_t d : dependents[i]) {
+                if (--pending[d] == 0) nextReady.push_back(d);
+            }
+        }
+        placed += ready.size();
+        waves.push_back(std::move(ready));
+        ready = std::move(nextReady);
+    }
+
+    cyclic.clear();
+    if (placed < tasks.size()) {
+        for (size_t i = 0; i < tasks.size(); ++i) {
+            if (pending[i] > 0) cyclic.push_back(i);
+        }
+    }
+    return waves;
+}
+
+bool runBuilds(const std::vector<BuildTask*>& tasks, const Config& config) {
+    if (tasks.empty()) return true;
+
+    size_t jobs = std::min<size_t>(config.buildJobs > 0 ? config.buildJobs : 1, tasks.size());
+    bool logged = jobs > 1;
+
+    std::string pacman;
+    SudoKeepAlive sudo;
+    if (logged) {
+        const char* home = std::getenv("HOME");
+        fs::path logDir = fs::path(home ? home : "/tmp") / "tolito" / "logs";
+        std::error_code ec;
+        fs::create_directories(logDir, ec);
+        for (BuildTask* task : tasks) {
+            if (task->logFile.empty()) {
+                task->logFile = (logDir / (task->name + ".log")).string();
+            }
+        }
+        pacman = serialPacmanWrapper();
+        if (!sudo.start()) {
+            std::cerr << RED << "[!] sudo authentication failed; cannot install build dependencies" << RESET << "\n";
+            return false;
+        }
+        std::cout << GREEN << ":: Building " << tasks.size() << " packages, " << jobs << " at a time..." << RESET << "\n";
+    }
+
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t i = next++; i < tasks.size(); i = next++) {
+            runBuild(*tasks[i], logged, pacman, config);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (size_t t = 1; t < jobs; ++t) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& th : pool) {
+        th.join();
+    }
+
+    return std::all_of(tasks.begin(), tasks.end(), [](const BuildTask* t) { return t->ok; });
+}
@@ -0,0 +1,243 @@
+#include "tolito-buildcache.h"
+#include "tolito-build.h"
+#include "tolito-sha256.h"
+#include "tolito-shell.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <functional>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+// Bump when the key inputs change so old entries are no longer matched
+static constexpr char KEY_VERSION[] = "tolito-build-v2";
+
+// makepkg.conf variables that change what makepkg produces
+static constexpr const char* BUILD_VARIABLES[] = {
+    "CARCH", "CHOST", "CPPFLAGS", "CFLAGS", "CXXFLAGS", "LDFLAGS", "LTOFLAGS", "RUSTFLAGS",
+    "DEBUG_CFLAGS", "DEBUG_CXXFLAGS", "DEBUG_RUSTFLAGS", "BUILDENV", "OPTIONS",
+    "STRIP_BINARIES", "STRIP_SHARED", "STRIP_STATIC", "PKGEXT", "PACKAGER",
+};
+
+// VCS packages compute pkgver while building, so their inputs don't pin the output
+static constexpr const char* VCS_SUFFIXES[] = {"-git", "-svn", "-hg", "-bzr", "-fossil", "-darcs"};
+
+// Guards stores and eviction between concurrent builds
+static std::mutex cacheMutex;
+
+static fs::path cacheRoot() {
+    const char* home = std::getenv("HOME");
+    return fs::path(home ? home : "/tmp") / ".cache" / "tolito" / "builds";
+}
+
+static bool isBuildVariable(const std::string& line) {
+    for (const char* var : BUILD_VARIABLES) {
+        size_t n = std::char_traits<char>::length(var);
+        if (line.compare(0, n, var) == 0 && line.size() > n && (line[n] == '=' || line.compare(n, 2, "+=") == 0)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Hash the relevant assignments of one makepkg.conf, following multi-line arrays
+static void hashMakepkgConf(const fs::path& path, Sha256& hash) {
+    std::ifstream in(path);
+    if (!in) return;
+
+    std::string line;
+    bool inArray = false;
+    while (std::getline(in, line)) {
+        line.erase(0, line.find_first_not_of(" \t"));
+        if (inArray) {
+            hash.update(line);
+            hash.update("\n");
+            if (line.find(')') != std::string::npos) inArray = false;
+            continue;
+        }
+        if (line.empty() || line[0] == '#' || !isBuildVariable(line)) continue;
+        hash.update(line);
+        hash.update("\n");
+        inArray = line.find("=(") != std::string::npos && line.find(')') == std::string::npos;
+    }
+}
+
+// Files makepkg reads its configuration from, in the order it sources them
+static std::vector<fs::path> makepkgConfFiles() {
+    std::vector<fs::path> files = {"/etc/makepkg.conf"};
+
+    std::vector<fs::path> dropins;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator("/etc/makepkg.conf.d", ec)) {
+        if (entry.path().extension() == ".conf") dropins.push_back(entry.path());
+    }
+    std::sort(dropins.begin(), dropins.end());
+    files.insert(files.end(), dropins.begin(), dropins.end());
+
+    const char* home = std::getenv("HOME");
+    const char* xdg = std::getenv("XDG_CONFIG_HOME");
+    if (xdg && *xdg) {
+        files.push_back(fs::path(xdg) / "pacman" / "makepkg.conf");
+    } else if (home) {
+        files.push_back(fs::path(home) / ".config" / "pacman" / "makepkg.conf");
+    }
+    if (home) {
+        files.push_back(fs::path(home) / ".makepkg.conf");
+    }
+    return files;
+}
+
+// Files git tracks in 'dir', relative to it (PKGBUILD only if 'dir' isn't a checkout)
+static std::vector<std::string> trackedFiles(const std::string& dir) {
+    std::vector<std::string> files;
+    FILE* pipe = popen(("git -C " + shellQuote(dir) + " ls-files -z 2>/dev/null").c_str(), "r");
+    if (pipe) {
+        std::string name;
+        int c;
+        while ((c = fgetc(pipe)) != EOF) {
+            if (c == '\0') {
+                if (!name.empty()) files.push_back(name);
+                name.clear();
+            } else {
+                name += static_cast<char>(c);
+            }
+        }
+        pclose(pipe);
+    }
+    if (files.empty() && fs::exists(fs::path(dir) / "PKGBUILD")) {
+        files.push_back("PKGBUILD");
+    }
+    return files;
+}
+
+std::string buildCacheKey(const std::string& dir, const std::string& name) {
+    for (const char* suffix : VCS_SUFFIXES) {
+        size_t n = std::char_traits<char>::length(suffix);
+        if (name.size() > n && name.compare(name.size() - n, n, suffix) == 0) return "";
+    }
+
+    std::vector<std::string> files = trackedFiles(dir);
+    if (files.empty()) return "";
+
+    Sha256 hash;
+    hash.update(KEY_VERSION);
+    for (const auto& file : files) {
+        std::ifstream in(fs::path(dir) / file, std::ios::binary);
+        if (!in) continue;
+        hash.update("\0file\0", 6);
+        hash.update(file);
+        hash.update("\0", 1);
+        char buf[1 << 16];
+        while (in.read(buf, sizeof(buf)) || in.gcount() > 0) {
+            hash.update(buf, static_cast<size_t>(in.gcount()));
+        }
+    }
+
+    hash.update("\0makepkg.conf\0", 14);
+    for (const auto& conf : makepkgConfFiles()) {
+        hashMakepkgConf(conf, hash);
+    }
+    // makepkg lets the environment override the configured flags
+    for (const char* var : BUILD_VARIABLES) {
+        if (const char* val = std::getenv(var)) {
+            hash.update(std::string(var) + "=" + val + "\n");
+        }
+    }
+    return hash.hexDigest();
+}
+
+std::vector<std::string> lookupBuildCache(const std::string& key, const std::string& name) {
+    if (key.empty()) return {};
+    fs::path entry = cacheRoot() / key;
+    std::error_code ec;
+    if (!fs::is_directory(entry, ec)) return {};
+
+    std::vector<std::string> artifacts = findBuiltPackages(entry.string(), name);
+    if (!artifacts.empty()) {
+        fs::last_write_time(entry, fs::file_time_type::clock::now(), ec);
+    }
+    return artifacts;
+}
+
+// Remove least recently used entries until the cache fits in 'maxBytes'
+static void evictBuildCache(unsigned long long maxBytes, const std::string& keep) {
+    struct Entry {
+        fs::path path;
+        fs::file_time_type used;
+        unsigned long long bytes;
+    };
+    std::vector<Entry> entries;
+    unsigned long long total = 0;
+
+    std::error_code ec;
+    for (const auto& dir : fs::directory_iterator(cacheRoot(), ec)) {
+        if (!dir.is_directory(ec) || dir.path().filename().string().find(".tmp-") != std::string::npos) continue;
+        Entry entry{dir.path(), fs::last_write_time(dir.path(), ec), 0};
+        for (const auto& file : fs::directory_iterator(dir.path(), ec)) {
+            if (file.is_regular_file(ec)) entry.bytes += file.file_size(ec);
+        }
+        total += entry.bytes;
+        entries.push_back(std::move(entry));
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.used < b.used; });
+    for (const auto& entry : entries) {
+        if (total <= maxBytes) break;
+        if (entry.path.filename() == keep) continue;
+        fs::remove_all(entry.path, ec);
+        if (!ec) total -= entry.bytes;
+    }
+}
+
+std::vector<std::string> storeBuildCache(const std::string& key, const std::vector<std::string>& files,
+                                         unsigned long long maxBytes) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    fs::path root = cacheRoot();
+    fs::path entry = root / key;
+    fs::path staging = root / (key + ".tmp-" + std::to_string(getpid()) + "-" +
+                               std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())));
+
+    std::error_code ec;
+    fs::create_directories(staging, ec);
+    if (ec) return files;
+
+    // Link or copy into staging; the built files stay put until the entry is
+    // published, so a failing cache never costs the install its packages
+    std::vector<std::string> cached;
+    for (const auto& file : files) {
+        fs::path name = fs::path(file).filename();
+        std::error_code linkEc;
+        fs::create_hard_link(file, staging / name, linkEc);
+        if (linkEc) {
+            // Different filesystem
+            fs::copy_file(file, staging / name, fs::copy_options::overwrite_existing, linkEc);
+        }
+        if (linkEc) {
+            fs::remove_all(staging, ec);
+            return files;
+        }
+        cached.push_back((entry / name).string());
+    }
+
+    // Publish the entry atomically; an identical build may already be there
+    fs::remove_all(entry, ec);
+    fs::rename(staging, entry, ec);
+    if (ec) {
+        fs::remove_all(staging, ec);
+        return files;
+    }
+    for (const auto& file : files) {
+        fs::remove(file, ec);
+    }
+
+    if (maxBytes > 0) {
+        evictBuildCache(maxBytes, key);
+    }
+    return cached;
+}
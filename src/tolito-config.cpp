@@ -0,0 +1,203 @@
+#include "tolito-config.h"
+
+#include <iostream>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+// ANSI colors
+static constexpr char RED[]    = "\033[31m";
+static constexpr char RESET[]  = "\033[0m";
+
+// Integer option clamped to [lo, hi]; 'fallback' (the default) if malformed
+static int parseIntOption(const std::string& val, int lo, int hi, int fallback) {
+    try {
+        return std::clamp(std::stoi(val), lo, hi);
+    } catch (...) {
+        return fallback;
+    }
+}
+
+// Read configuration and return settings
+Config readConfig() {
+    Config config;
+    fs::path cfgdir = fs::path(std::getenv("HOME")) / ".config" / "tolito";
+    fs::path conf   = cfgdir / "tolito.conf";
+
+    if (!fs::exists(cfgdir))
+        fs::create_directories(cfgdir);
+
+    if (!fs::exists(conf)) {
+        std::ofstream out(conf);
+        if (!out) {
+            std::cerr << RED << "[!] Failed to create config at " << conf << RESET << "\n";
+            return config;
+        }
+        out << "# tolito configuration\n"
+               "ask_before_fallback_into_aur = 1\n"
+               "warn_about_aur_only = 1\n\n"
+               "[UpdateRules]\n"
+               "_CURATED_:\n"
+               "getFromAUR=true\n"
+               "getFromChaotic=true\n"
+               "main=CURATED\n"
+               "alternative=AUR\n"
+               "fallback=CHAOTIC\n\n"
+               "_AUR_:\n"
+               "getFromCurated=true\n"
+               "getFromChaotic=true\n"
+               "main=AUR\n"
+               "alternative=CHAOTIC\n"
+               "fallback=CURATED\n\n"
+               "_CHAOTIC_:\n"
+               "getFromCurated=true\n"
+               "getFromAUR=true\n"
+               "main=CHAOTIC\n"
+               "alternative=AUR\n"
+               "fallback=CURATED\n\n"
+               "askBeforeSwitchSources=false\n\n"
+               "[repositories]\n"
+               "chaotic-aur:\n"
+               "Include=/home/$USER/.config/tolito/tolito.d/chaotic-mirrorlist\n"
+               "SigLevel=Optional\n";
+        return config;
+    }
+
+    std::ifstream in(conf);
+    if (!in) {
+        std::cerr << RED << "[!] Could not open configuration: " << conf << RESET << "\n";
+        return config;
+    }
+    
+    std::string line;
+    std::string currentSection = "";
+    std::string currentRule = "";
+    std::string currentRepo = "";
+    
+    while (std::getline(in, line)) {
+        if (auto c = line.find('#'); c != std::string::npos) line.erase(c);
+        
+        // Trim whitespace
+        line.erase(line.begin(), std::find_if(line.begin(), line.end(), [](char c){ return !std::isspace(c); }));
+        line.erase(std::find_if(line.rbegin(), line.rend(), [](char c){ return !std::isspace(c); }).base(), line.end());
+        
+        if (line.empty()) continue;
+        
+        // Check for section headers
+        if (line.front() == '[' && line.back() == ']') {
+            currentSection = line.substr(1, line.length() - 2);
+            currentRule = "";
+            currentRepo = "";
+            continue;
+        }
+        
+        // Check for rule/repo names (ending with :)
+        if (line.back() == ':') {
+            if (currentSection == "UpdateRules") {
+                currentRule = line.substr(0, line.length() - 1);
+            } else if (currentSection == "repositories") {
+                currentRepo = line.substr(0, line.length() - 1);
+            }
+            continue;
+        }
+        
+        // Parse key=value pairs
+        if (auto eq = line.find('='); eq != std::string::npos) {
+            std::string key = line.substr(0, eq);
+            std::string val = line.substr(eq + 1);
+            
+            // Trim key and value
+            key.erase(key.begin(), std::find_if(key.begin(), key.end(), [](char c){ return !std::isspace(c); }));
+            key.erase(std::find_if(key.rbegin(), key.rend(), [](char c){ return !std::isspace(c); }).base(), key.end());
+            val.erase(val.begin(), std::find_if(val.begin(), val.end(), [](char c){ return !std::isspace(c); }));
+            val.erase(std::find_if(val.rbegin(), val.rend(), [](char c){ return !std::isspace(c); }).base(), val.end());
+            
+            // Convert key to lowercase for comparison
+            std::string lowerKey = key;
+            std::transform(lowerKey.begin(), lowerKey.end(), lowerKey.begin(), [](unsigned char c){ return std::tolower(c); });
+            std::transform(val.begin(), val.end(), val.begin(), [](unsigned char c){ return std::tolower(c); });
+            
+            // Parse global settings
+            if (currentSection.empty()) {
+                if (lowerKey == "ask_before_fallback_into_aur") {
+                    config.askBeforeAUR = (val == "1" || val == "true");
+                } else if (lowerKey == "warn_about_aur_only") {
+                    config.warnAboutAUR = (val == "1" || val == "true");
+                } else if (lowerKey == "askbeforeswitchsources") {
+                    config.askBeforeSwitchSources = (val == "1" || val == "true");
+                }
+            }
+            // Parse Misc section
+            else if (currentSection == "Misc") {
+                if (lowerKey == "ilovecandy") {
+                    config.iLoveCandy = (val == "1" || val == "true");
+                } else if (lowerKey == "disabledownloadtimeout") {
+                    config.disableDownloadTimeout = (val == "1" || val == "true");
+                } else if (lowerKey == "color") {
+                    config.color = (val == "1" || val == "true");
+                } else if (lowerKey == "paralleldownloads") {
+                    config.parallelDownloads = parseIntOption(val, 1, 64, config.parallelDownloads);
+                } else if (lowerKey == "downloadsegments") {
+                    config.downloadSegments = parseIntOption(val, 1, 16, config.downloadSegments);
+                } else if (lowerKey == "buildjobs") {
+                    config.buildJobs = parseIntOption(val, 1, 64, config.buildJobs);
+                } else if (lowerKey == "buildcachesize") {
+                    config.buildCacheSize = parseIntOption(val, 0, 1 << 20, config.buildCacheSize);
+                } else if (lowerKey == "parallelupdatechecks") {
+                    config.parallelUpdateChecks = parseIntOption(val, 1, 64, config.parallelUpdateChecks);
+                }
+            }
+            // Parse UpdateRules
+            else if (currentSection == "UpdateRules" && !currentRule.empty()) {
+                if (lowerKey == "getfromaur") {
+                    config.updateRules[currentRule].getFromAUR = (val == "true");
+                } else if (lowerKey == "getfromchaotic") {
+                    config.updateRules[currentRule].getFromChaotic = (val == "true");
+                } else if (lowerKey == "getfromcurated") {
+                    config.updateRules[currentRule].getFromCurated = (val == "true");
+                } else if (lowerKey == "main") {
+                    config.updateRules[currentRule].main = val;
+                    std::transform(config.updateRules[currentRule].main.begin(), config.updateRules[currentRule].main.end(), config.updateRules[currentRule].main.begin(), ::toupper);
+                } else if (lowerKey == "alternative") {
+                    config.updateRules[currentRule].alternative = val;
+                    std::transform(config.updateRules[currentRule].alternative.begin(), config.updateRules[currentRule].alternative.end(), config.updateRules[currentRule].alternative.begin(), ::toupper);
+                } else if (lowerKey == "fallback") {
+                    config.updateRules[currentRule].fallback = val;
+                    std::transform(config.updateRules[currentRule].fallback.begin(), config.updateRules[currentRule].fallback.end(), config.updateRules[currentRule].fallback.begin(), ::toupper);
+                }
+            }
+            // Parse repositories
+            else if (currentSection == "repositories" && !currentRepo.empty()) {
+                if (lowerKey == "servers") {
+                    // Split comma-separated servers
+                    std::stringstream ss(val);
+                    std::string server;
+                    while (std::getline(ss, server, ',')) {
+                        // Trim server
+                        server.erase(server.begin(), std::find_if(server.begin(), server.end(), [](char c){ return !std::isspace(c); }));
+                        server.erase(std::find_if(server.rbegin(), server.rend(), [](char c){ return !std::isspace(c); }).base(), server.end());
+                        if (!server.empty()) {
+                            config.repositories[currentRepo].servers.push_back(server);
+                        }
+                    }
+                    config.repositories[currentRepo].name = currentRepo;
+                } else if (lowerKey == "siglevel") {
+                    config.repositories[currentRepo].siglevel = val;
+                } else if (lowerKey == "include") {
+                    // Don't lowercase the include path value
+                    std::string originalVal = line.substr(line.find('=') + 1);
+                    originalVal.erase(originalVal.begin(), std::find_if(originalVal.begin(), originalVal.end(), [](char c){ return !std::isspace(c); }));
+                    originalVal.erase(std::find_if(originalVal.rbegin(), originalVal.rend(), [](char c){ return !std::isspace(c); }).base(), originalVal.end());
+                    config.repositories[currentRepo].includePath = originalVal;
+                    config.repositories[currentRepo].name = currentRepo;
+                }
+            }
+        }
+    }
+    return config;
+}
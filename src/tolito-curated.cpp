@@ -0,0 +1,388 @@
+#include "tolito-curated.h"
+#include "tolito-repo.h"
+#include "tolito-repoindex.h"
+#include "tolito-shell.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+static constexpr char MONOREPO[] = "https://github.com/Xray-OS/viper-pkgbuilds";
+
+// Per-run state of the curated checkout
+struct CuratedSession {
+    std::string path;                       // Empty until the clone is known to exist
+    bool refreshed = false;
+    bool treeLoaded = false;
+    std::map<std::string, std::string> blobs; // "<package>/<file>" -> object id at HEAD
+    std::map<std::string, std::string> trees; // Package directory -> tree id at HEAD
+    std::set<std::string> cone;               // Package directories checked out this run
+    RepoIndex manifest;                       // Package metadata at HEAD (see loadManifestLocked)
+    bool manifestLoaded = false;
+};
+
+static std::mutex sessionMutex;
+static CuratedSession session;
+
+static int git(const std::string& args) {
+    std::string cmd = "git -C " + shellQuote(session.path) + " " + args + " >/dev/null 2>&1";
+    return std::system(cmd.c_str());
+}
+
+// Clone on first use and make sure sparse-checkout is in cone mode
+static bool ensureCloneLocked() {
+    if (!session.path.empty()) return true;
+
+    const char* home = std::getenv("HOME");
+    if (!home) return false;
+    fs::path path = fs::path(home) / "tolito" / "viper-pkgbuilds";
+
+    if (!fs::exists(path)) {
+        std::string cloneCmd = "git clone -q --depth 1 --filter=blob:none --sparse " + std::string(MONOREPO) +
+                               " " + shellQuote(path.string()) + " >/dev/null 2>&1";
+        if (std::system(cloneCmd.c_str()) != 0) return false;
+        session.refreshed = true; // A fresh clone is as new as a fetch
+    }
+    session.path = path.string();
+
+    if (git("config core.sparseCheckout") != 0) {
+        git("sparse-checkout init --cone");
+    }
+    return true;
+}
+
+// List <package>/<file> blobs and package directory trees of HEAD once per commit
+static void loadTreeLocked() {
+    if (session.treeLoaded) return;
+    session.blobs.clear();
+    session.trees.clear();
+    session.treeLoaded = true;
+
+    FILE* pipe = popen(("git -C " + shellQuote(session.path) + " ls-tree -r -t HEAD 2>/dev/null").c_str(), "r");
+    if (!pipe) return;
+    char buf[1024];
+    while (fgets(buf, sizeof(buf), pipe)) {
+        // "<mode> blob <oid>\t<path>" or "040000 tree <oid>\t<path>"
+        std::string line = buf;
+        if (!line.empty() && line.back() == '\n') line.pop_back();
+        size_t tab = line.find('\t');
+        if (tab == std::string::npos) continue;
+        std::string path = line.substr(tab + 1);
+        if (line.compare(7, 5, "tree ") == 0) {
+            if (path.find('/') == std::string::npos) session.trees[path] = line.substr(12, tab - 12);
+            continue;
+        }
+        if (line.compare(7, 5, "blob ") != 0) continue;
+        size_t slash = path.find('/');
+        if (slash == std::string::npos || path.find('/', slash + 1) != std::string::npos) continue;
+        session.blobs[path] = line.substr(12, tab - 12);
+    }
+    pclose(pipe);
+}
+
+std::string curatedRepoPath() {
+    std::lock_guard<std::mutex> lock(sessionMutex);
+    return ensureCloneLocked() ? session.path : "";
+}
+
+bool refreshCuratedRepo() {
+    std::lock_guard<std::mutex> lock(sessionMutex);
+    if (!ensureCloneLocked()) return false;
+    if (session.refreshed) return true;
+    session.refreshed = true;
+
+    if (git("fetch -q --depth 1 --filter=blob:none origin") != 0) return false;
+    session.treeLoaded = false;
+    session.manifestLoaded = false;
+    return git("reset -q --hard FETCH_HEAD") == 0;
+}
+
+// Blobs of HEAD not present locally; walking the tree this way never fetches
+static std::set<std::string> missingBlobsLocked() {
+    std::set<std::string> missing;
+    FILE* pipe = popen(("git -C " + shellQuote(session.path) + " rev-list --objects --no-walk --missing=print HEAD 2>/dev/null").c_str(), "r");
+    if (!pipe) return missing;
+    char buf[1024];
+    while (fgets(buf, sizeof(buf), pipe)) {
+        if (buf[0] != '?') continue;
+        std::string oid = buf + 1;
+        oid.erase(oid.find_last_not_of(" \n") + 1);
+        missing.insert(oid);
+    }
+    pclose(pipe);
+    return missing;
+}
+
+// Run git cat-file --batch with object ids on stdin (from a temporary file) and return its output
+static std::string catFileBatch(const std::vector<std::string>& oids) {
+    char tmpl[] = "/tmp/tolito-oids-XXXXXX";
+    int fd = mkstemp(tmpl);
+    if (fd < 0) return "";
+    {
+        std::ofstream out(tmpl);
+        for (const auto& oid : oids) {
+            out << oid << "\n";
+        }
+    }
+    close(fd);
+
+    std::string cmd = "git -C " + shellQuote(session.path) + " cat-file --batch < " + tmpl + " 2>/dev/null";
+    std::string output;
+    FILE* pipe = popen(cmd.c_str(), "r");
+    if (pipe) {
+        char buf[1 << 16];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), pipe)) > 0) {
+            output.append(buf, n);
+        }
+        pclose(pipe);
+    }
+    std::remove(tmpl);
+    return output;
+}
+
+// Contents of <package>/<file> for each request at HEAD, read with one git
+// process; missing files yield empty strings
+static std::vector<std::string> readFilesLocked(const std::vector<std::pair<std::string, std::string>>& files) {
+    std::vector<std::string> contents(files.size());
+    loadTreeLocked();
+
+    std::vector<std::string> oids;
+    std::set<std::string> unique;
+    for (const auto& [name, file] : files) {
+        auto it = session.blobs.find(name + "/" + file);
+        if (it != session.blobs.end() && unique.insert(it->second).second) {
+            oids.push_back(it->second);
+        }
+    }
+    if (oids.empty()) return contents;
+
+    // The clone is blobless: fetch whatever is missing in one request
+    // instead of letting git fetch each blob lazily
+    std::set<std::string> absent = missingBlobsLocked();
+    std::string missing;
+    for (const auto& oid : oids) {
+        if (absent.count(oid)) missing += " " + oid;
+    }
+    if (!missing.empty()) {
+        git("-c fetch.negotiationAlgorithm=noop fetch -q --no-tags --no-write-fetch-head --filter=blob:none origin" + missing);
+    }
+
+    // "<oid> <type> <size>\n<contents>\n" per object
+    std::string batch = catFileBatch(oids);
+    std::map<std::string, std::string> byOid;
+    size_t pos = 0;
+    while (pos < batch.size()) {
+        size_t eol = batch.find('\n', pos);
+        if (eol == std::string::npos) break;
+        std::string header = batch.substr(pos, eol - pos);
+        pos = eol + 1;
+        size_t sp1 = header.find(' ');
+        size_t sp2 = header.rfind(' ');
+        if (sp1 == std::string::npos || sp1 == sp2) continue; // "<oid> missing"
+        size_t size = std::strtoull(header.c_str() + sp2 + 1, nullptr, 10);
+        if (pos + size > batch.size()) break;
+        byOid[header.substr(0, sp1)] = batch.substr(pos, size);
+        pos += size + 1;
+    }
+
+    for (size_t i = 0; i < files.size(); ++i) {
+        auto blob = session.blobs.find(files[i].first + "/" + files[i].second);
+        if (blob == session.blobs.end()) continue;
+        auto it = byOid.find(blob->second);
+        if (it != byOid.end()) contents[i] = it->second;
+    }
+    return contents;
+}
+
+// Strip surrounding quotes from a PKGBUILD value
+static std::string unquote(std::string val) {
+    if (val.size() >= 2 && (val.front() == '"' || val.front() == '\'') && val.back() == val.front()) {
+        val = val.substr(1, val.size() - 2);
+    }
+    return val;
+}
+
+// Full pacman version ([epoch:]pkgver-pkgrel); empty without pkgver/pkgrel
+static std::string formatVersion(const std::string& epoch, const std::string& pkgver, const std::string& pkgrel) {
+    if (pkgver.empty() || pkgrel.empty()) return "";
+    return (epoch.empty() || epoch == "0" ? "" : epoch + ":") + pkgver + "-" + pkgrel;
+}
+
+// Package entry from a .SRCINFO: the pkgbase section's version and description,
+// plus depends, makedepends and checkdepends (and their variants for 'arch').
+// A split package section named 'name' replaces the base depends.
+static PackageInfo parseSrcinfo(const std::string& name, const std::string& srcinfo, const std::string& arch) {
+    PackageInfo pkg;
+    pkg.name = name;
+    pkg.directory = name;
+
+    std::string epoch, pkgver, pkgrel;
+    std::vector<std::string> depends, buildDepends, ownDepends;
+    bool inBase = true, inOwn = false, ownHasDepends = false;
+
+    std::istringstream in(srcinfo);
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t eq = line.find(" = ");
+        if (eq == std::string::npos) continue;
+        std::string key = line.substr(0, eq);
+        key.erase(0, key.find_first_not_of(" \t"));
+        std::string val = line.substr(eq + 3);
+        val.erase(val.find_last_not_of(" \t\r") + 1);
+
+        if (key == "pkgname") {
+            inBase = false;
+            inOwn = (val == name);
+            continue;
+        }
+        bool isDepends = key == "depends" || key == "depends_" + arch;
+        if (inOwn && isDepends) {
+            ownDepends.push_back(val);
+            ownHasDepends = true;
+        }
+        if (!inBase) continue;
+
+        if (key == "pkgver") pkgver = val;
+        else if (key == "pkgrel") pkgrel = val;
+        else if (key == "epoch") epoch = val;
+        else if (key == "pkgdesc") pkg.description = val;
+        else if (isDepends) depends.push_back(val);
+        else if (key == "makedepends" || key == "makedepends_" + arch ||
+                 key == "checkdepends" || key == "checkdepends_" + arch) buildDepends.push_back(val);
+    }
+
+    pkg.version = formatVersion(epoch, pkgver, pkgrel);
+    pkg.depends = ownHasDepends ? ownDepends : depends;
+    pkg.depends.insert(pkg.depends.end(), buildDepends.begin(), buildDepends.end());
+    return pkg;
+}
+
+// Fallback for packages without a .SRCINFO: literal pkgver/pkgrel/epoch
+// assignments only, since evaluating the PKGBUILD would mean running it
+static PackageInfo parsePkgbuild(const std::string& name, const std::string& pkgbuild) {
+    PackageInfo pkg;
+    pkg.name = name;
+    pkg.directory = name;
+
+    std::string epoch, pkgver, pkgrel;
+    std::istringstream in(pkgbuild);
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t eq = line.find('=');
+        if (eq == std::string::npos) continue;
+        std::string key = line.substr(0, eq);
+        std::string val = line.substr(eq + 1);
+        val.erase(val.find_last_not_of(" \t\r") + 1);
+        val = unquote(val);
+        if (val.find_first_of("$`( ") != std::string::npos) continue;
+
+        if (key == "pkgver") pkgver = val;
+        else if (key == "pkgrel") pkgrel = val;
+        else if (key == "epoch") epoch = val;
+    }
+    pkg.version = formatVersion(epoch, pkgver, pkgrel);
+    return pkg;
+}
+
+static fs::path manifestPath() {
+    const char* home = std::getenv("HOME");
+    return fs::path(home ? home : "/tmp") / ".cache" / "tolito" / "curated.idx";
+}
+
+// Object id of the HEAD tree, which identifies the manifest contents
+static std::string headTreeLocked() {
+    std::string tree;
+    FILE* pipe = popen(("git -C " + shellQuote(session.path) + " rev-parse 'HEAD^{tree}' 2>/dev/null").c_str(), "r");
+    if (!pipe) return tree;
+    char buf[128];
+    if (fgets(buf, sizeof(buf), pipe)) {
+        tree = buf;
+        tree.erase(tree.find_last_not_of(" \n") + 1);
+    }
+    pclose(pipe);
+    return tree;
+}
+
+// Open the manifest for HEAD, rebuilding it from the .SRCINFO files when the
+// cached one was written for a different tree
+static bool loadManifestLocked() {
+    if (session.manifestLoaded) return session.manifest.isOpen();
+    session.manifestLoaded = true;
+
+    std::string tree = headTreeLocked();
+    if (tree.empty()) return false;
+    const std::string arch = getSystemArch();
+    const std::string stamp = tree + ":" + arch;
+    const std::string path = manifestPath().string();
+
+    if (session.manifest.open(path) && session.manifest.stamp() == stamp) {
+        return true;
+    }
+    session.manifest.close();
+
+    // One file per package directory: .SRCINFO, or the PKGBUILD if there is none
+    loadTreeLocked();
+    std::vector<std::pair<std::string, std::string>> files;
+    for (const auto& [file, oid] : session.blobs) {
+        size_t slash = file.find('/');
+        if (file.compare(slash + 1, std::string::npos, "PKGBUILD") != 0) continue;
+        std::string name = file.substr(0, slash);
+        files.emplace_back(name, session.blobs.count(name + "/.SRCINFO") ? ".SRCINFO" : "PKGBUILD");
+    }
+
+    std::vector<std::string> contents = readFilesLocked(files);
+    std::map<std::string, PackageInfo> packages;
+    for (size_t i = 0; i < files.size(); ++i) {
+        const auto& [name, file] = files[i];
+        packages[name] = (file == ".SRCINFO") ? parseSrcinfo(name, contents[i], arch) : parsePkgbuild(name, contents[i]);
+    }
+
+    std::error_code ec;
+    fs::create_directories(manifestPath().parent_path(), ec);
+    if (!writeRepoIndex(path, packages, stamp)) return false;
+    return session.manifest.open(path);
+}
+
+bool curatedPackageExists(const std::string& name) {
+    std::lock_guard<std::mutex> lock(sessionMutex);
+    return ensureCloneLocked() && loadManifestLocked() && session.manifest.contains(name);
+}
+
+bool findCuratedPackage(const std::string& name, PackageInfo& out) {
+    std::lock_guard<std::mutex> lock(sessionMutex);
+    return ensureCloneLocked() && loadManifestLocked() && session.manifest.find(name, out);
+}
+
+std::string curatedPackageTree(const std::string& name) {
+    std::lock_guard<std::mutex> lock(sessionMutex);
+    if (!ensureCloneLocked()) return "";
+    loadTreeLocked();
+    auto it = session.trees.find(name);
+    return it != session.trees.end() ? it->second : "";
+}
+
+bool checkoutCuratedPackages(const std::vector<std::string>& names) {
+    std::lock_guard<std::mutex> lock(sessionMutex);
+    if (!ensureCloneLocked()) return false;
+
+    size_t before = session.cone.size();
+    session.cone.insert(names.begin(), names.end());
+    if (session.cone.size() == before && before > 0) return true;
+
+    std::string dirs;
+    for (const auto& name : session.cone) {
+        dirs += " " + shellQuote(name);
+    }
+    // Clean untracked files to avoid sparse-checkout warnings
+    git("clean -fd");
+    return git("sparse-checkout set" + dirs) == 0;
+}
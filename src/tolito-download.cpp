@@ -0,0 +1,541 @@
+#include "tolito-download.h"
+#include "tolito-mirror.h"
+#include "tolito-sha256.h"
+
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <memory>
+#include <algorithm>
+#include <curl/curl.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// ANSI colors
+static constexpr char RED[]    = "\033[31m";
+static constexpr char RESET[]  = "\033[0m";
+
+// Redraw the progress bars at most this often
+static constexpr long REDRAW_INTERVAL_MS = 200;
+
+// A transfer is considered stalled below 1 byte/s for this long
+static constexpr long STALL_TIMEOUT_SECONDS = 30;
+
+// Resume on the same mirror at most this many times before moving on
+static constexpr int MAX_RESUMES_PER_MIRROR = 2;
+
+// Only files at least this large are split into segments
+static constexpr unsigned long long SEGMENT_THRESHOLD = 16ULL * 1024 * 1024;
+
+// One byte range of a job (the whole file unless the job is segmented)
+struct Transfer {
+    DownloadJob* job = nullptr;
+    std::string partFile;
+    curl_off_t rangeStart = 0;
+    curl_off_t rangeEnd = -1;    // Inclusive; -1 = until end of file
+    size_t mirror = 0;           // Index into job->urls
+    size_t mirrorsTried = 0;
+    int resumes = 0;
+    curl_off_t resumedFrom = 0;  // Bytes already in partFile when the attempt started
+    bool rangeIgnored = false;   // Server answered a ranged request with the full file
+    bool hashing = false;        // Checksum the file as it is written (first or only range)
+    Sha256 hash;                 // Over the first 'hashed' bytes of partFile
+    curl_off_t hashed = 0;
+    FILE* fp = nullptr;
+    CURL* handle = nullptr;
+    curl_off_t dltotal = 0;
+    curl_off_t dlnow = 0;
+    std::chrono::steady_clock::time_point started;
+    bool finished = false;
+    bool ok = false;
+};
+
+// Progress and completion state shared by a job's transfers
+struct JobState {
+    DownloadJob* job = nullptr;
+    std::vector<Transfer*> transfers;
+    std::chrono::steady_clock::time_point started;
+    bool shown = false;
+    bool checksumFailed = false;
+};
+
+// Pacman-compatible progress line (based on pacman source)
+static std::string progressLine(const std::string& filename, curl_off_t dltotal, curl_off_t dlnow, double elapsed, const Config& config) {
+    double percentage = dltotal > 0 ? (double)dlnow / (double)dltotal * 100.0 : 0.0;
+    double mb = dlnow / (1024.0 * 1024.0);
+    
+    // Calculate speed
+    double speed = (elapsed > 0) ? (double)dlnow / elapsed : 0;
+    int speed_kb = (int)(speed / 1024);
+    
+    // Calculate ETA
+    int eta_sec = (speed > 0 && dlnow < dltotal) ? (int)((dltotal - dlnow) / speed) : 0;
+    int eta_min = eta_sec / 60;
+    eta_sec %= 60;
+    
+    struct winsize w;
+    int term_width = (ioctl(STDOUT_FILENO, TIOCGWINSZ, &w) == 0) ? w.ws_col : 80;
+    
+    // Calculate info length for proper bar width
+    char info_buf[256];
+    snprintf(info_buf, sizeof(info_buf), "%s %.1f MiB %d KiB/s %02d:%02d ", 
+             filename.c_str(), mb, speed_kb, eta_min, eta_sec);
+    
+    int info_len = strlen(info_buf);
+    int bar_width = term_width - info_len - 8; // -8 for [ ] and " 100%"
+    if (bar_width < 10) bar_width = 10;
+    
+    int filled = (int)(percentage * bar_width / 100.0);
+    
+    std::string line;
+    char buf[512];
+    if (config.color) {
+        // Package name in cyan, values in white, units in cyan
+        snprintf(buf, sizeof(buf), "\033[1;36m%s\033[0m \033[0;37m%.1f\033[0m \033[1;36mMiB\033[0m \033[0;37m%d\033[0m \033[1;36mKiB/s\033[0m \033[0;37m%02d:%02d\033[0m [",
+                 filename.c_str(), mb, speed_kb, eta_min, eta_sec);
+        line += buf;
+    } else {
+        line += info_buf;
+        line += "[";
+    }
+    
+    if (config.iLoveCandy) {
+        // Pac-Man style progress bar
+        for (int i = 0; i < bar_width; ++i) {
+            if (i < filled - 1) {
+                line += config.color ? "\033[1;33m-\033[0m" : "-";
+            } else if (i == filled - 1 && filled > 0) {
+                const char* mouth = ((int)percentage % 2 == 0) ? "C" : "c";
+                line += config.color ? std::string("\033[1;33m") + mouth + "\033[0m" : std::string(mouth);
+            } else if (i % 3 == 0) {
+                line += config.color ? "\033[0;37mo\033[0m" : "o";
+            } else {
+                line += " ";
+            }
+        }
+    } else {
+        // Standard progress bar
+        for (int i = 0; i < bar_width; ++i) {
+            if (i < filled) {
+                line += config.color ? "\033[1;32m#\033[0m" : "#";
+            } else {
+                line += "-";
+            }
+        }
+    }
+    
+    if (config.color) {
+        snprintf(buf, sizeof(buf), "] \033[0;37m%3.0f%%\033[0m", percentage);
+    } else {
+        snprintf(buf, sizeof(buf), "] %3.0f%%", percentage);
+    }
+    line += buf;
+    return line;
+}
+
+static int progressCallback(void* clientp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t /*ultotal*/, curl_off_t /*ulnow*/) {
+    auto* transfer = static_cast<Transfer*>(clientp);
+    transfer->dltotal = dltotal;
+    transfer->dlnow = dlnow;
+    return 0;
+}
+
+static size_t writeCallback(char* data, size_t size, size_t nmemb, void* userp) {
+    auto* t = static_cast<Transfer*>(userp);
+    if (t->rangeStart > 0 || t->rangeEnd >= 0) {
+        // Appending a full response to a range would corrupt the file
+        long code = 0;
+        curl_easy_getinfo(t->handle, CURLINFO_RESPONSE_CODE, &code);
+        if (code != 206) {
+            t->rangeIgnored = true;
+            return 0;
+        }
+    }
+    size_t written = fwrite(data, size, nmemb, t->fp);
+    if (t->hashing) {
+        t->hash.update(data, written * size);
+        t->hashed += written * size;
+    }
+    return written;
+}
+
+static curl_off_t fileSize(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? st.st_size : 0;
+}
+
+// Bytes from earlier attempts plus the current one, and the expected total
+static void jobProgress(const JobState& state, curl_off_t& total, curl_off_t& now) {
+    total = 0;
+    now = 0;
+    for (const Transfer* t : state.transfers) {
+        now += t->resumedFrom + t->dlnow;
+        if (t->rangeEnd >= 0) {
+            total += t->rangeEnd - t->rangeStart + 1;
+        } else if (t->dltotal > 0) {
+            total += t->resumedFrom + t->dltotal;
+        }
+    }
+    if (state.job->size > 0) {
+        total = state.job->size;
+    }
+}
+
+// Redraw one line per started job, moving the cursor back over the previous block
+static void renderProgress(const std::vector<JobState*>& shown, size_t& drawnLines, const Config& config) {
+    if (drawnLines > 0) {
+        printf("\033[%zuA", drawnLines);
+    }
+    auto now = std::chrono::steady_clock::now();
+    for (const JobState* state : shown) {
+        curl_off_t total, done;
+        jobProgress(*state, total, done);
+        std::chrono::duration<double> elapsed = now - state->started;
+        printf("\r\033[2K%s\n", progressLine(state->job->displayName, total, done, elapsed.count(), config).c_str());
+    }
+    drawnLines = shown.size();
+    fflush(stdout);
+}
+
+// Bring the checksum in line with a part file left by an earlier run or
+// restarted after a failed attempt; within a run it already is
+static void syncHash(Transfer& t, curl_off_t have) {
+    if (!t.hashing || t.hashed == have) return;
+    t.hash = Sha256();
+    t.hashed = 0;
+    FILE* fp = have > 0 ? fopen(t.partFile.c_str(), "rb") : nullptr;
+    if (!fp) return;
+    char buf[1 << 16];
+    size_t n;
+    while (t.hashed < have && (n = fread(buf, 1, std::min<curl_off_t>(sizeof(buf), have - t.hashed), fp)) > 0) {
+        t.hash.update(buf, n);
+        t.hashed += n;
+    }
+    fclose(fp);
+}
+
+// Open the part file and queue the transfer's current mirror on the multi handle,
+// continuing from whatever a previous attempt left on disk
+static bool startTransfer(CURLM* multi, Transfer& t, const Config& config) {
+    DownloadJob& job = *t.job;
+    curl_off_t have = fileSize(t.partFile);
+    syncHash(t, have);
+    if (t.rangeEnd >= 0 && have >= t.rangeEnd - t.rangeStart + 1) {
+        // Segment already complete from an earlier run
+        t.resumedFrom = have;
+        t.dlnow = 0;
+        t.finished = true;
+        t.ok = true;
+        return true;
+    }
+    
+    t.fp = fopen(t.partFile.c_str(), "ab");
+    if (!t.fp) return false;
+    
+    // Reused handles keep their connections to the same mirror alive
+    if (!t.handle) {
+        t.handle = curl_easy_init();
+        if (!t.handle) {
+            fclose(t.fp);
+            t.fp = nullptr;
+            return false;
+        }
+    } else {
+        curl_easy_reset(t.handle);
+    }
+    
+    t.resumedFrom = have;
+    t.rangeIgnored = false;
+    t.dltotal = 0;
+    t.dlnow = 0;
+    t.started = std::chrono::steady_clock::now();
+    
+    CURL* curl = t.handle;
+    curl_easy_setopt(curl, CURLOPT_URL, job.urls[t.mirror].c_str());
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writeCallback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &t);
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 10L);
+    
+    if (t.rangeEnd >= 0) {
+        std::string range = std::to_string(t.rangeStart + have) + "-" + std::to_string(t.rangeEnd);
+        curl_easy_setopt(curl, CURLOPT_RANGE, range.c_str());
+    } else if (have > 0) {
+        curl_easy_setopt(curl, CURLOPT_RESUME_FROM_LARGE, have);
+    }
+    
+    // Abort stalled transfers instead of capping the total time, so large
+    // packages on slow links still complete
+    if (!config.disableDownloadTimeout) {
+        curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1L);
+        curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, STALL_TIMEOUT_SECONDS);
+    }
+    
+    curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+    curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, progressCallback);
+    curl_easy_setopt(curl, CURLOPT_XFERINFODATA, &t);
+    curl_easy_setopt(curl, CURLOPT_PRIVATE, &t);
+    
+    return curl_multi_add_handle(multi, curl) == CURLM_OK;
+}
+
+// Decide how to continue after a failed attempt; returns false once every mirror failed
+static bool retryTransfer(Transfer& t, CURLcode result) {
+    long code = 0;
+    curl_easy_getinfo(t.handle, CURLINFO_RESPONSE_CODE, &code);
+    
+    if (t.rangeIgnored || result == CURLE_RANGE_ERROR || code == 416) {
+        // The mirror can't continue this part file; restart it from scratch,
+        // on the same mirror unless it ignores ranges for a segment anyway
+        std::remove(t.partFile.c_str());
+        if (t.rangeEnd < 0 && t.resumedFrom > 0) {
+            return true;
+        }
+    } else if (t.dlnow > 0 && t.resumes < MAX_RESUMES_PER_MIRROR) {
+        // The mirror was delivering data; pick up where it stopped
+        ++t.resumes;
+        return true;
+    }
+    
+    // Fail over to the next mirror, keeping the bytes received so far
+    t.resumes = 0;
+    if (++t.mirrorsTried >= t.job->urls.size()) {
+        return false;
+    }
+    t.mirror = (t.mirror + 1) % t.job->urls.size();
+    return true;
+}
+
+// Join segment files into the first one, extending its checksum with them
+static bool joinSegments(const JobState& state) {
+    Transfer& first = *state.transfers.front();
+    FILE* out = fopen(first.partFile.c_str(), "ab");
+    if (!out) return false;
+    
+    bool ok = true;
+    char buf[1 << 16];
+    for (size_t i = 1; i < state.transfers.size() && ok; ++i) {
+        const std::string& part = state.transfers[i]->partFile;
+        FILE* in = fopen(part.c_str(), "rb");
+        if (!in) {
+            ok = false;
+            break;
+        }
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+            if (fwrite(buf, 1, n, out) != n) {
+                ok = false;
+                break;
+            }
+            if (first.hashing) {
+                first.hash.update(buf, n);
+                first.hashed += n;
+            }
+        }
+        fclose(in);
+        if (ok) std::remove(part.c_str());
+    }
+    if (fclose(out) != 0) ok = false;
+    return ok;
+}
+
+// All transfers of a job have finished: assemble, verify and move the file into place
+static void finishJob(JobState& state) {
+    DownloadJob& job = *state.job;
+    for (const Transfer* t : state.transfers) {
+        // Part files are kept so the next run can resume them
+        if (!t->ok) return;
+    }
+    if (state.transfers.size() > 1 && !joinSegments(state)) {
+        return;
+    }
+    Transfer& first = *state.transfers.front();
+    const std::string& part = first.partFile;
+    curl_off_t size = fileSize(part);
+    if (job.size > 0 && (unsigned long long)size != job.size) {
+        std::remove(part.c_str());
+        return;
+    }
+    if (first.hashing) {
+        std::string digest = first.hashed == size ? first.hash.hexDigest() : sha256File(part);
+        if (digest != job.sha256) {
+            state.checksumFailed = true;
+            std::remove(part.c_str());
+            return;
+        }
+    }
+    job.ok = std::rename(part.c_str(), job.output.c_str()) == 0;
+}
+
+// Split a job into one transfer per segment, each starting on a different mirror
+static void planTransfers(DownloadJob& job, JobState& state, std::vector<std::unique_ptr<Transfer>>& transfers, const Config& config) {
+    size_t segments = 1;
+    if (job.size >= SEGMENT_THRESHOLD && config.downloadSegments > 1) {
+        segments = std::min<size_t>(config.downloadSegments, job.urls.size());
+    }
+    
+    if (segments <= 1) {
+        auto t = std::make_unique<Transfer>();
+        t->job = &job;
+        t->partFile = job.output + ".part";
+        t->hashing = !job.sha256.empty();
+        state.transfers.push_back(t.get());
+        transfers.push_back(std::move(t));
+        return;
+    }
+    
+    curl_off_t size = (curl_off_t)job.size;
+    curl_off_t chunk = size / (curl_off_t)segments;
+    for (size_t i = 0; i < segments; ++i) {
+        auto t = std::make_unique<Transfer>();
+        t->job = &job;
+        t->partFile = job.output + ".part" + std::to_string(i + 1) + "of" + std::to_string(segments);
+        t->rangeStart = (curl_off_t)i * chunk;
+        t->rangeEnd = (i + 1 == segments) ? size - 1 : t->rangeStart + chunk - 1;
+        t->mirror = i % job.urls.size();
+        t->hashing = i == 0 && !job.sha256.empty();
+        state.transfers.push_back(t.get());
+        transfers.push_back(std::move(t));
+    }
+}
+
+bool runDownloads(std::vector<DownloadJob>& jobs, const Config& config) {
+    if (jobs.empty()) return true;
+    
+    CURLM* multi = curl_multi_init();
+    if (!multi) return false;
+    
+    std::vector<JobState> states(jobs.size());
+    std::vector<std::unique_ptr<Transfer>> transfers;
+    std::deque<Transfer*> pending;
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        states[i].job = &jobs[i];
+        jobs[i].ok = false;
+        if (jobs[i].urls.empty()) continue;
+        
+        // A complete download from an earlier run was never renamed
+        std::string part = jobs[i].output + ".part";
+        if (jobs[i].size > 0 && (unsigned long long)fileSize(part) == jobs[i].size) {
+            if (jobs[i].sha256.empty() || sha256File(part) == jobs[i].sha256) {
+                jobs[i].ok = std::rename(part.c_str(), jobs[i].output.c_str()) == 0;
+                if (jobs[i].ok) continue;
+            }
+            std::remove(part.c_str());
+        }
+        
+        planTransfers(jobs[i], states[i], transfers, config);
+        for (Transfer* t : states[i].transfers) {
+            pending.push_back(t);
+        }
+    }
+    
+    std::map<DownloadJob*, JobState*> stateOf;
+    for (auto& state : states) {
+        stateOf[state.job] = &state;
+    }
+    
+    std::vector<JobState*> shown;
+    size_t drawnLines = 0;
+    size_t active = 0;
+    size_t limit = config.parallelDownloads > 0 ? config.parallelDownloads : 1;
+    auto lastDraw = std::chrono::steady_clock::now();
+    
+    auto transferDone = [&](Transfer* t) {
+        JobState& state = *stateOf[t->job];
+        for (const Transfer* other : state.transfers) {
+            if (!other->finished) return;
+        }
+        finishJob(state);
+    };
+    
+    while (active > 0 || !pending.empty()) {
+        // Keep the pipeline full
+        while (active < limit && !pending.empty()) {
+            Transfer* t = pending.front();
+            pending.pop_front();
+            JobState& state = *stateOf[t->job];
+            if (!state.shown) {
+                state.shown = true;
+                state.started = std::chrono::steady_clock::now();
+                shown.push_back(&state);
+            }
+            if (!startTransfer(multi, *t, config)) {
+                t->finished = true;
+                transferDone(t);
+                continue;
+            }
+            if (t->finished) {
+                transferDone(t);
+                continue;
+            }
+            ++active;
+        }
+        
+        int running = 0;
+        curl_multi_perform(multi, &running);
+        
+        int queued;
+        while (CURLMsg* msg = curl_multi_info_read(multi, &queued)) {
+            if (msg->msg != CURLMSG_DONE) continue;
+            
+            Transfer* t = nullptr;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, reinterpret_cast<char**>(&t));
+            curl_multi_remove_handle(multi, msg->easy_handle);
+            fclose(t->fp);
+            t->fp = nullptr;
+            --active;
+            
+            DownloadJob& job = *t->job;
+            bool ok = msg->data.result == CURLE_OK;
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - t->started;
+            if (!job.repo.empty() && t->mirror < job.mirrors.size()) {
+                recordMirrorTransfer(job.repo, job.mirrors[t->mirror], ok, (double)t->dlnow, elapsed.count());
+            }
+            
+            if (ok) {
+                t->ok = true;
+                t->finished = true;
+                transferDone(t);
+            } else if (retryTransfer(*t, msg->data.result)) {
+                pending.push_front(t);
+            } else {
+                t->finished = true;
+                transferDone(t);
+            }
+        }
+        
+        auto now = std::chrono::steady_clock::now();
+        if (std::chrono::duration_cast<std::chrono::milliseconds>(now - lastDraw).count() >= REDRAW_INTERVAL_MS) {
+            renderProgress(shown, drawnLines, config);
+            lastDraw = now;
+        }
+        
+        if (active > 0) {
+            curl_multi_poll(multi, nullptr, 0, 100, nullptr);
+        }
+    }
+    renderProgress(shown, drawnLines, config);
+    saveMirrorRankings();
+    
+    for (auto& t : transfers) {
+        if (t->handle) curl_easy_cleanup(t->handle);
+    }
+    curl_multi_cleanup(multi);
+    
+    bool allOk = true;
+    for (const auto& state : states) {
+        if (state.checksumFailed) {
+            allOk = false;
+            std::cerr << RED << "[!] Checksum mismatch for " << state.job->displayName << ", file discarded" << RESET << "\n";
+        } else if (!state.job->ok) {
+            allOk = false;
+            std::cerr << RED << "[!] Failed to download " << state.job->displayName << RESET << "\n";
+        }
+    }
+    return allOk;
+}
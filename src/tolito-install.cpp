@@ -1,23 +1,30 @@
 #include "tolito-install.h"
-#include "tolito-key.h"
+#include "tolito-config.h"
+#include "tolito-syncdb.h"
+#include "tolito-repo.h"
+#include "tolito-download.h"
+#include "tolito-build.h"
+#include "tolito-buildcache.h"
+#include "tolito-aur.h"
+#include "tolito-curated.h"
+#include "tolito-localdb.h"
+#include "tolito-sources.h"
+#include "tolito-transaction.h"
+#include "tolito-sha256.h"
+#include "tolito-shell.h"
 
 #include <iostream>
 #include <cstdlib>
 #include <string>
 #include <filesystem>
-#include <fstream>
 #include <algorithm>
 #include <cctype>
-#include <regex>
 #include <cstdio>
 #include <map>
+#include <set>
 #include <vector>
-#include <sstream>
-#include <iomanip>
-#include <chrono>
-#include <curl/curl.h>
 #include <cstring>
-#include <sys/ioctl.h>
+#include <ctime>
 #include <unistd.h>
 
 namespace fs = std::filesystem;
@@ -56,7 +63,6 @@ static std::string getRepoName(const std::string& url) {
 }
 
 // constants
-static constexpr char MONOREPO[] = "https://github.com/Xray-OS/viper-pkgbuilds";
 static constexpr char AUR_NS[] = "https://aur.archlinux.org/";
 
 // ANSI colors
@@ -79,398 +85,6 @@ static bool isUrl(const std::string& url) {
          ||url.rfind("git@", 0) == 0;
 }
 
-// Repository configuration
-struct Repository {
-    std::string name;
-    std::vector<std::string> servers;
-    std::string siglevel;
-    std::string includePath;
-};
-
-// Parse mirrorlist file and return servers
-static std::vector<std::string> parseMirrorlist(const std::string& path) {
-    std::vector<std::string> servers;
-    std::ifstream file(path);
-    std::string line;
-    
-    while (std::getline(file, line)) {
-        // Remove comments
-        if (auto c = line.find('#'); c != std::string::npos) line.erase(c);
-        
-        // Trim whitespace
-        line.erase(line.begin(), std::find_if(line.begin(), line.end(), [](char c){ return !std::isspace(c); }));
-        line.erase(std::find_if(line.rbegin(), line.rend(), [](char c){ return !std::isspace(c); }).base(), line.end());
-        
-        if (line.empty()) continue;
-        
-        // Look for Server = URL lines
-        if (line.find("Server") == 0) {
-            size_t eq = line.find('=');
-            if (eq != std::string::npos) {
-                std::string url = line.substr(eq + 1);
-                url.erase(url.begin(), std::find_if(url.begin(), url.end(), [](char c){ return !std::isspace(c); }));
-                url.erase(std::find_if(url.rbegin(), url.rend(), [](char c){ return !std::isspace(c); }).base(), url.end());
-                if (!url.empty()) {
-                    servers.push_back(url);
-                }
-            }
-        }
-    }
-    return servers;
-}
-
-// Update rules configuration
-struct UpdateRule {
-    std::string main;
-    std::string alternative;
-    std::string fallback;
-    bool getFromAUR = false;
-    bool getFromChaotic = false;
-    bool getFromCurated = false;
-};
-
-// Configuration structure to hold settings
-struct Config {
-    bool askBeforeAUR = true;
-    bool warnAboutAUR = true;
-    bool askBeforeSwitchSources = false;
-    std::map<std::string, UpdateRule> updateRules;
-    std::map<std::string, Repository> repositories;
-    // Misc options
-    bool iLoveCandy = false;
-    bool disableDownloadTimeout = false;
-    bool color = true;
-};
-
-// Pacman-compatible progress callback (based on pacman source)
-static int progressCallback(void* clientp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t /*ultotal*/, curl_off_t /*ulnow*/) {
-    if (dltotal <= 0) return 0;
-    
-    auto* data = static_cast<std::pair<std::string, Config>*>(clientp);
-    const std::string& filename = data->first;
-    const Config& config = data->second;
-    
-    static curl_off_t last_dlnow = 0;
-    static auto last_update = std::chrono::steady_clock::now();
-    static auto start_time = std::chrono::steady_clock::now();
-    
-    auto now = std::chrono::steady_clock::now();
-    auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_update).count();
-    
-    // Only update if significant change or time passed
-    if (dlnow != dltotal && dlnow == last_dlnow && elapsed_ms < 200) {
-        return 0;
-    }
-    
-    last_dlnow = dlnow;
-    last_update = now;
-    
-    double percentage = (double)dlnow / (double)dltotal * 100.0;
-    double mb = dlnow / (1024.0 * 1024.0);
-    
-    // Calculate speed
-    auto total_elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - start_time).count();
-    double speed = (total_elapsed > 0) ? (double)dlnow / total_elapsed : 0;
-    int speed_kb = (int)(speed / 1024);
-    
-    // Calculate ETA
-    int eta_sec = (speed > 0 && dlnow < dltotal) ? (int)((dltotal - dlnow) / speed) : 0;
-    int eta_min = eta_sec / 60;
-    eta_sec %= 60;
-    
-    struct winsize w;
-    int term_width = (ioctl(STDOUT_FILENO, TIOCGWINSZ, &w) == 0) ? w.ws_col : 80;
-    
-    // Calculate info length for proper bar width
-    char info_buf[256];
-    snprintf(info_buf, sizeof(info_buf), "%s %.1f MiB %d KiB/s %02d:%02d ", 
-             filename.c_str(), mb, speed_kb, eta_min, eta_sec);
-    
-    int info_len = strlen(info_buf);
-    int bar_width = term_width - info_len - 8; // -8 for [ ] and " 100%"
-    if (bar_width < 10) bar_width = 10;
-    
-    int filled = (int)(percentage * bar_width / 100.0);
-    
-    // Clear line and print progress with colors
-    printf("\r\033[2K");
-    
-    if (config.color) {
-        // Package name in cyan, values in white, units in cyan
-        printf("\033[1;36m%s\033[0m \033[0;37m%.1f\033[0m \033[1;36mMiB\033[0m \033[0;37m%d\033[0m \033[1;36mKiB/s\033[0m \033[0;37m%02d:%02d\033[0m [",
-               filename.c_str(), mb, speed_kb, eta_min, eta_sec);
-    } else {
-        printf("%s[", info_buf);
-    }
-    
-    if (config.iLoveCandy) {
-        // Pac-Man style progress bar
-        for (int i = 0; i < bar_width; ++i) {
-            if (i < filled - 1) {
-                if (config.color) {
-                    printf("\033[1;33m-\033[0m");
-                } else {
-                    printf("-");
-                }
-            } else if (i == filled - 1 && filled > 0) {
-                if (config.color) {
-                    printf("\033[1;33m%s\033[0m", ((int)percentage % 2 == 0) ? "C" : "c");
-                } else {
-                    printf("%s", ((int)percentage % 2 == 0) ? "C" : "c");
-                }
-            } else if (i % 3 == 0) {
-                if (config.color) {
-                    printf("\033[0;37mo\033[0m");
-                } else {
-                    printf("o");
-                }
-            } else {
-                printf(" ");
-            }
-        }
-    } else {
-        // Standard progress bar
-        for (int i = 0; i < bar_width; ++i) {
-            if (i < filled) {
-                if (config.color) {
-                    printf("\033[1;32m#\033[0m");
-                } else {
-                    printf("#");
-                }
-            } else {
-                printf("-");
-            }
-        }
-    }
-    
-    if (config.color) {
-        printf("] \033[0;37m%3.0f%%\033[0m", percentage);
-    } else {
-        printf("] %3.0f%%", percentage);
-    }
-    fflush(stdout);
-    
-    return 0;
-}
-
-// Download file with libcurl and pacman-style progress
-static bool downloadWithProgress(const std::string& url, const std::string& output, const Config& config, const std::string& filename = "") {
-    CURL* curl = curl_easy_init();
-    if (!curl) return false;
-    
-    FILE* fp = fopen(output.c_str(), "wb");
-    if (!fp) {
-        curl_easy_cleanup(curl);
-        return false;
-    }
-    
-    std::string display_name = filename;
-    if (display_name.empty()) {
-        display_name = output.substr(output.find_last_of('/') + 1);
-    }
-    if (display_name.find(".pkg.tar") != std::string::npos) {
-        display_name = display_name.substr(0, display_name.find(".pkg.tar"));
-    }
-    
-    std::pair<std::string, Config> progress_data = {display_name, config};
-    
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, fp);
-    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 10L);
-    
-    if (!config.disableDownloadTimeout) {
-        curl_easy_setopt(curl, CURLOPT_TIMEOUT, 120L);
-    }
-    
-    curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
-    
-    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
-    curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, progressCallback);
-    curl_easy_setopt(curl, CURLOPT_XFERINFODATA, &progress_data);
-    
-    CURLcode res = curl_easy_perform(curl);
-    
-    fclose(fp);
-    curl_easy_cleanup(curl);
-    
-    if (res == CURLE_OK) {
-        std::cout << "\n";
-        return true;
-    } else {
-        return false;
-    }
-}
-
-// Read configuration and return settings
-static Config readConfig() {
-    Config config;
-    fs::path cfgdir = fs::path(std::getenv("HOME")) / ".config" / "tolito";
-    fs::path conf   = cfgdir / "tolito.conf";
-
-    if (!fs::exists(cfgdir))
-        fs::create_directories(cfgdir);
-
-    if (!fs::exists(conf)) {
-        std::ofstream out(conf);
-        if (!out) {
-            std::cerr << RED << "[!] Failed to create config at " << conf << RESET << "\n";
-            return config;
-        }
-        out << "# tolito configuration\n"
-               "ask_before_fallback_into_aur = 1\n"
-               "warn_about_aur_only = 1\n\n"
-               "[UpdateRules]\n"
-               "_CURATED_:\n"
-               "getFromAUR=true\n"
-               "getFromChaotic=true\n"
-               "main=CURATED\n"
-               "alternative=AUR\n"
-               "fallback=CHAOTIC\n\n"
-               "_AUR_:\n"
-               "getFromCurated=true\n"
-               "getFromChaotic=true\n"
-               "main=AUR\n"
-               "alternative=CHAOTIC\n"
-               "fallback=CURATED\n\n"
-               "_CHAOTIC_:\n"
-               "getFromCurated=true\n"
-               "getFromAUR=true\n"
-               "main=CHAOTIC\n"
-               "alternative=AUR\n"
-               "fallback=CURATED\n\n"
-               "askBeforeSwitchSources=false\n\n"
-               "[repositories]\n"
-               "chaotic-aur:\n"
-               "Include=/home/$USER/.config/tolito/tolito.d/chaotic-mirrorlist\n"
-               "SigLevel=Optional\n";
-        return config;
-    }
-
-    std::ifstream in(conf);
-    if (!in) {
-        std::cerr << RED << "[!] Could not open configuration: " << conf << RESET << "\n";
-        return config;
-    }
-    
-    std::string line;
-    std::string currentSection = "";
-    std::string currentRule = "";
-    std::string currentRepo = "";
-    
-    while (std::getline(in, line)) {
-        if (auto c = line.find('#'); c != std::string::npos) line.erase(c);
-        
-        // Trim whitespace
-        line.erase(line.begin(), std::find_if(line.begin(), line.end(), [](char c){ return !std::isspace(c); }));
-        line.erase(std::find_if(line.rbegin(), line.rend(), [](char c){ return !std::isspace(c); }).base(), line.end());
-        
-        if (line.empty()) continue;
-        
-        // Check for section headers
-        if (line.front() == '[' && line.back() == ']') {
-            currentSection = line.substr(1, line.length() - 2);
-            currentRule = "";
-            currentRepo = "";
-            continue;
-        }
-        
-        // Check for rule/repo names (ending with :)
-        if (line.back() == ':') {
-            if (currentSection == "UpdateRules") {
-                currentRule = line.substr(0, line.length() - 1);
-            } else if (currentSection == "repositories") {
-                currentRepo = line.substr(0, line.length() - 1);
-            }
-            continue;
-        }
-        
-        // Parse key=value pairs
-        if (auto eq = line.find('='); eq != std::string::npos) {
-            std::string key = line.substr(0, eq);
-            std::string val = line.substr(eq + 1);
-            
-            // Trim key and value
-            key.erase(key.begin(), std::find_if(key.begin(), key.end(), [](char c){ return !std::isspace(c); }));
-            key.erase(std::find_if(key.rbegin(), key.rend(), [](char c){ return !std::isspace(c); }).base(), key.end());
-            val.erase(val.begin(), std::find_if(val.begin(), val.end(), [](char c){ return !std::isspace(c); }));
-            val.erase(std::find_if(val.rbegin(), val.rend(), [](char c){ return !std::isspace(c); }).base(), val.end());
-            
-            // Convert key to lowercase for comparison
-            std::string lowerKey = key;
-            std::transform(lowerKey.begin(), lowerKey.end(), lowerKey.begin(), [](unsigned char c){ return std::tolower(c); });
-            std::transform(val.begin(), val.end(), val.begin(), [](unsigned char c){ return std::tolower(c); });
-            
-            // Parse global settings
-            if (currentSection.empty()) {
-                if (lowerKey == "ask_before_fallback_into_aur") {
-                    config.askBeforeAUR = (val == "1" || val == "true");
-                } else if (lowerKey == "warn_about_aur_only") {
-                    config.warnAboutAUR = (val == "1" || val == "true");
-                } else if (lowerKey == "askbeforeswitchsources") {
-                    config.askBeforeSwitchSources = (val == "1" || val == "true");
-                }
-            }
-            // Parse Misc section
-            else if (currentSection == "Misc") {
-                if (lowerKey == "ilovecandy") {
-                    config.iLoveCandy = (val == "1" || val == "true");
-                } else if (lowerKey == "disabledownloadtimeout") {
-                    config.disableDownloadTimeout = (val == "1" || val == "true");
-                } else if (lowerKey == "color") {
-                    config.color = (val == "1" || val == "true");
-                }
-            }
-            // Parse UpdateRules
-            else if (currentSection == "UpdateRules" && !currentRule.empty()) {
-                if (lowerKey == "getfromaur") {
-                    config.updateRules[currentRule].getFromAUR = (val == "true");
-                } else if (lowerKey == "getfromchaotic") {
-                    config.updateRules[currentRule].getFromChaotic = (val == "true");
-                } else if (lowerKey == "getfromcurated") {
-                    config.updateRules[currentRule].getFromCurated = (val == "true");
-                } else if (lowerKey == "main") {
-                    config.updateRules[currentRule].main = val;
-                    std::transform(config.updateRules[currentRule].main.begin(), config.updateRules[currentRule].main.end(), config.updateRules[currentRule].main.begin(), ::toupper);
-                } else if (lowerKey == "alternative") {
-                    config.updateRules[currentRule].alternative = val;
-                    std::transform(config.updateRules[currentRule].alternative.begin(), config.updateRules[currentRule].alternative.end(), config.updateRules[currentRule].alternative.begin(), ::toupper);
-                } else if (lowerKey == "fallback") {
-                    config.updateRules[currentRule].fallback = val;
-                    std::transform(config.updateRules[currentRule].fallback.begin(), config.updateRules[currentRule].fallback.end(), config.updateRules[currentRule].fallback.begin(), ::toupper);
-                }
-            }
-            // Parse repositories
-            else if (currentSection == "repositories" && !currentRepo.empty()) {
-                if (lowerKey == "servers") {
-                    // Split comma-separated servers
-                    std::stringstream ss(val);
-                    std::string server;
-                    while (std::getline(ss, server, ',')) {
-                        // Trim server
-                        server.erase(server.begin(), std::find_if(server.begin(), server.end(), [](char c){ return !std::isspace(c); }));
-                        server.erase(std::find_if(server.rbegin(), server.rend(), [](char c){ return !std::isspace(c); }).base(), server.end());
-                        if (!server.empty()) {
-                            config.repositories[currentRepo].servers.push_back(server);
-                        }
-                    }
-                    config.repositories[currentRepo].name = currentRepo;
-                } else if (lowerKey == "siglevel") {
-                    config.repositories[currentRepo].siglevel = val;
-                } else if (lowerKey == "include") {
-                    // Don't lowercase the include path value
-                    std::string originalVal = line.substr(line.find('=') + 1);
-                    originalVal.erase(originalVal.begin(), std::find_if(originalVal.begin(), originalVal.end(), [](char c){ return !std::isspace(c); }));
-                    originalVal.erase(std::find_if(originalVal.rbegin(), originalVal.rend(), [](char c){ return !std::isspace(c); }).base(), originalVal.end());
-                    config.repositories[currentRepo].includePath = originalVal;
-                    config.repositories[currentRepo].name = currentRepo;
-                }
-            }
-        }
-    }
-    return config;
-}
-
 // Determine a writable work directory under $HOME (~/tolito)
 static fs::path getWorkDir() {
     const char* home = std::getenv("HOME");
@@ -490,301 +104,10 @@ static fs::path getWorkDir() {
     return dir;
 }
 
-// Check if package is already built
-static bool isPackageBuilt() {
-    std::string findCmd = "ls *.pkg.tar.* 2>/dev/null | head -1";
-    FILE* pipe = popen(findCmd.c_str(), "r");
-    bool found = false;
-    if (pipe) {
-        char buf[256];
-        if (fgets(buf, sizeof(buf), pipe)) {
-            found = true;
-        }
-        pclose(pipe);
-    }
-    return found;
-}
-
-// Check if package exists in AUR by trying to access the git repo
-static bool packageExistsInAUR(const std::string& spec) {
-    std::string aurUrl = std::string(AUR_NS) + spec + ".git";
-    std::string checkCmd = "git ls-remote " + aurUrl + " > /dev/null 2>&1";
-    return std::system(checkCmd.c_str()) == 0;
-}
-
-// Check if package is built in a specific directory
-static bool isPackageBuiltInDir(const std::string& dir) {
+// Check if the package in a specific directory has a cached build of its current inputs
+static bool isPackageBuiltInDir(const std::string& dir, const std::string& spec) {
     if (!fs::exists(dir)) return false;
-    
-    fs::path currentDir = fs::current_path();
-    fs::current_path(dir);
-    bool built = isPackageBuilt();
-    fs::current_path(currentDir);
-    return built;
-}
-
-// Handle choice between curated, AUR, and repository when multiple sources exist
-
-// Build package only, no installation
-static bool buildPackage(const std::string& prevKey = "") {
-    std::string buildCmd = "makepkg -s";
-    std::cout << YELLOW << "[~] " << buildCmd << RESET << "\n";
-    int buildRc = std::system(buildCmd.c_str());
-    
-    if (buildRc != 0) {
-        if (WEXITSTATUS(buildRc) == 2) {
-            return false;
-        }
-        
-        // Check for PGP key issues
-        std::string output;
-        FILE* pipe = popen("makepkg --nobuild 2>&1", "r");
-        if (pipe) {
-            char buf[256];
-            while (fgets(buf, sizeof(buf), pipe)) {
-                output += buf;
-            }
-            pclose(pipe);
-            
-            std::regex re(R"(unknown public key ([0-9A-F]+))", std::regex::icase);
-            std::smatch m;
-            if (std::regex_search(output, m, re) && m.size() >= 2) {
-                std::string keyId = m[1].str();
-                
-                if (keyId != prevKey) {
-                    std::cout << YELLOW << "[*] Missing PGP key " << keyId << ", importing..." << RESET << "\n";
-                    if (fetchAndTrustgKey(keyId)) {
-                        return buildPackage(keyId);
-                    }
-                }
-            }
-        }
-        return false;
-    }
-    
-    return true;
-}
-
-// Package information structure
-struct PackageInfo {
-    std::string name;
-    std::string version;
-    std::string description;
-    std::vector<std::string> depends;
-    std::string filename;
-};
-
-// Parse package description file
-static PackageInfo parsePackageDesc(const std::string& descFile) {
-    PackageInfo pkg;
-    std::ifstream file(descFile);
-    std::string line;
-    std::string currentSection;
-    
-    while (std::getline(file, line)) {
-        if (line.empty()) continue;
-        
-        if (line.front() == '%' && line.back() == '%') {
-            currentSection = line.substr(1, line.length() - 2);
-        } else if (currentSection == "NAME") {
-            pkg.name = line;
-        } else if (currentSection == "VERSION") {
-            pkg.version = line;
-        } else if (currentSection == "DESC") {
-            pkg.description = line;
-        } else if (currentSection == "DEPENDS") {
-            pkg.depends.push_back(line);
-        } else if (currentSection == "FILENAME") {
-            pkg.filename = line;
-        }
-    }
-    return pkg;
-}
-
-// Get system architecture
-static std::string getSystemArch() {
-    FILE* pipe = popen("uname -m", "r");
-    if (!pipe) return "x86_64";
-    
-    char buffer[128];
-    std::string result = "";
-    if (fgets(buffer, sizeof(buffer), pipe)) {
-        result = buffer;
-        if (!result.empty() && result.back() == '\n') {
-            result.pop_back();
-        }
-    }
-    pclose(pipe);
-    return result.empty() ? "x86_64" : result;
-}
-
-// Replace variables in repository URL
-static std::string replaceRepoVars(const std::string& url, const std::string& repo, const std::string& arch) {
-    std::string result = url;
-    size_t pos = 0;
-    while ((pos = result.find("$repo", pos)) != std::string::npos) {
-        result.replace(pos, 5, repo);
-        pos += repo.length();
-    }
-    pos = 0;
-    while ((pos = result.find("$arch", pos)) != std::string::npos) {
-        result.replace(pos, 5, arch);
-        pos += arch.length();
-    }
-    return result;
-}
-
-// Test mirror speed and return response time in ms
-static int testMirrorSpeed(const std::string& url, const std::string& repo, const std::string& arch) {
-    std::string testUrl = replaceRepoVars(url, repo, arch) + "/" + repo + ".db";
-    std::string testCmd = "curl -s -w '%{time_total}' -o /dev/null --connect-timeout 5 --max-time 10 '" + testUrl + "' 2>/dev/null";
-    
-    FILE* pipe = popen(testCmd.c_str(), "r");
-    if (!pipe) return 9999;
-    
-    char buffer[32];
-    std::string result;
-    if (fgets(buffer, sizeof(buffer), pipe)) {
-        result = buffer;
-    }
-    pclose(pipe);
-    
-    try {
-        double seconds = std::stod(result);
-        return static_cast<int>(seconds * 1000); // Convert to ms
-    } catch (...) {
-        return 9999; // Failed
-    }
-}
-
-// Select best mirror from list (reorder, don't remove)
-static std::vector<std::string> selectBestMirrors(const std::vector<std::string>& mirrors, const std::string& repo) {
-    if (mirrors.empty()) return mirrors;
-    
-    std::string arch = getSystemArch();
-    std::vector<std::pair<std::string, int>> mirrorTimes;
-    
-    std::cout << YELLOW << ":: Fetching best mirrors..." << RESET << std::flush;
-    
-    for (const auto& mirror : mirrors) {
-        int time = testMirrorSpeed(mirror, repo, arch);
-        mirrorTimes.push_back({mirror, time});
-        std::cout << "." << std::flush;
-    }
-    
-    // Sort by response time (working mirrors first, then failed ones)
-    std::sort(mirrorTimes.begin(), mirrorTimes.end(), 
-              [](const auto& a, const auto& b) { 
-                  if (a.second < 9999 && b.second >= 9999) return true;
-                  if (a.second >= 9999 && b.second < 9999) return false;
-                  return a.second < b.second;
-              });
-    
-    std::vector<std::string> sortedMirrors;
-    for (const auto& [mirror, time] : mirrorTimes) {
-        sortedMirrors.push_back(mirror);
-    }
-    
-    std::cout << " done" << RESET << "\n";
-    return sortedMirrors;
-}
-
-// Global cache for repository databases
-static std::map<std::string, std::map<std::string, PackageInfo>> repoCache;
-
-// Download and parse repository database
-static std::map<std::string, PackageInfo> downloadRepoDatabase(const Repository& repo, bool silent = false) {
-    // Check cache first
-    if (repoCache.find(repo.name) != repoCache.end()) {
-        return repoCache[repo.name];
-    }
-    
-    std::map<std::string, PackageInfo> packages;
-    std::string arch = getSystemArch();
-    fs::path cacheDir = fs::path(std::getenv("HOME")) / ".cache" / "tolito" / "repos";
-    fs::create_directories(cacheDir);
-    
-    // Get servers from Include path or use configured servers
-    std::vector<std::string> servers = repo.servers;
-    if (!repo.includePath.empty()) {
-        // Expand $USER in path
-        std::string expandedPath = repo.includePath;
-        if (expandedPath.find("$USER") != std::string::npos) {
-            std::string user = std::getenv("USER") ? std::getenv("USER") : "";
-            size_t pos = 0;
-            while ((pos = expandedPath.find("$USER", pos)) != std::string::npos) {
-                expandedPath.replace(pos, 5, user);
-                pos += user.length();
-            }
-        }
-        
-        if (fs::exists(expandedPath)) {
-            auto mirrorServers = parseMirrorlist(expandedPath);
-            if (!mirrorServers.empty()) {
-                servers = selectBestMirrors(mirrorServers, repo.name);
-            }
-        } else {
-            std::cerr << RED << "[!] Mirrorlist not found: " << expandedPath << RESET << "\n";
-        }
-    }
-    
-    for (const auto& serverUrl : servers) {
-        std::string url = replaceRepoVars(serverUrl, repo.name, arch);
-        std::string dbUrl = url + "/" + repo.name + ".db";
-        std::string dbFile = (cacheDir / (repo.name + ".db")).string();
-        
-        // Download database file with timeout
-        std::string downloadCmd = "curl --connect-timeout 10 --max-time 60 -s -L \"" + dbUrl + "\" -o \"" + dbFile + "\"";
-        
-        if (std::system(downloadCmd.c_str()) == 0 && fs::exists(dbFile) && fs::file_size(dbFile) > 0) {
-            // Extract and parse database
-            std::string extractDir = (cacheDir / repo.name).string();
-            std::string extractCmd = "rm -rf \"" + extractDir + "\" && mkdir -p \"" + extractDir + "\" && tar -xf \"" + dbFile + "\" -C \"" + extractDir + "\" 2>/dev/null";
-            
-            if (std::system(extractCmd.c_str()) == 0) {
-                // Parse extracted package directories
-                try {
-                    for (const auto& entry : fs::directory_iterator(extractDir)) {
-                        if (entry.is_directory()) {
-                            fs::path descFile = entry.path() / "desc";
-                            if (fs::exists(descFile)) {
-                                PackageInfo pkg = parsePackageDesc(descFile.string());
-                                if (!pkg.name.empty()) {
-                                    packages[pkg.name] = pkg;
-                                }
-                            }
-                        }
-                    }
-                } catch (const std::exception& e) {
-                    std::cerr << RED << "[!] Error parsing database: " << e.what() << RESET << "\n";
-                    continue;
-                }
-                
-                if (!packages.empty()) {
-                    // Cache the result
-                    repoCache[repo.name] = packages;
-                    break; // Successfully parsed from this server
-                }
-            } else {
-                if (!silent) {
-                    std::cerr << RED << "[!] Failed to extract database from " << serverUrl << RESET << "\n";
-                }
-            }
-        } else {
-            if (!silent) {
-                std::cerr << RED << "[!] Failed to download database from " << serverUrl << RESET << "\n";
-            }
-        }
-    }
-    return packages;
-}
-
-
-
-// Check if package exists in repository
-static bool packageExistsInRepo(const std::string& pkgName, const Repository& repo) {
-    auto packages = downloadRepoDatabase(repo, true); // Silent during existence check
-    return packages.find(pkgName) != packages.end();
+    return !lookupBuildCache(buildCacheKey(dir, spec), spec).empty();
 }
 
 // Handle choice between curated and AUR when both sources exist
@@ -792,8 +115,8 @@ static int handleMultiSourceChoice(const std::string& spec, const fs::path& WORK
     std::string aurDir = (WORK / spec).string();
     std::string curatedDir = pkgdir.string();
     
-    bool aurBuilt = isPackageBuiltInDir(aurDir);
-    bool curatedBuilt = isPackageBuiltInDir(curatedDir);
+    bool aurBuilt = isPackageBuiltInDir(aurDir, spec);
+    bool curatedBuilt = isPackageBuiltInDir(curatedDir, spec);
     
     std::cout << YELLOW << "[?] '" << spec << "' available in multiple sources" << RESET << "\n";
     
@@ -822,251 +145,136 @@ static int handleMultiSourceChoice(const std::string& spec, const fs::path& WORK
     return 1; // AUR (default)
 }
 
-// Download package from repository - returns: 0=failure, 1=success, 2=user_declined
-static int downloadFromRepo(const std::string& pkgName, const Repository& repo, const fs::path& workDir, const Config& config) {
-    auto packages = downloadRepoDatabase(repo);
-    auto it = packages.find(pkgName);
-    if (it == packages.end()) {
-        return 0;
-    }
+// Check a package file already in the work directory against the database
+// entry: size and SHA-256 when the repository lists them, otherwise at least
+// a zstd, xz or gzip header
+static bool isValidPackageFile(const std::string& pkgFile, const PackageInfo& pkg) {
+    std::error_code ec;
+    auto size = fs::file_size(pkgFile, ec);
+    if (ec || size == 0 || (pkg.compressedSize > 0 && size != pkg.compressedSize)) return false;
+    if (!pkg.sha256.empty()) return sha256File(pkgFile) == pkg.sha256;
+    
+    static constexpr unsigned char ZSTD[] = {0x28, 0xb5, 0x2f, 0xfd};
+    static constexpr unsigned char XZ[] = {0xfd, '7', 'z', 'X', 'Z', 0x00};
+    static constexpr unsigned char GZIP[] = {0x1f, 0x8b};
+    unsigned char magic[6] = {};
+    FILE* f = fopen(pkgFile.c_str(), "rb");
+    if (!f) return false;
+    size_t n = fread(magic, 1, sizeof(magic), f);
+    fclose(f);
+    return (n >= sizeof(ZSTD) && std::memcmp(magic, ZSTD, sizeof(ZSTD)) == 0) ||
+           (n >= sizeof(XZ) && std::memcmp(magic, XZ, sizeof(XZ)) == 0) ||
+           (n >= sizeof(GZIP) && std::memcmp(magic, GZIP, sizeof(GZIP)) == 0);
+}
+
+// Describe how to fetch a repository package: one url per ranked mirror
+static DownloadJob makeRepoDownload(const PackageInfo& pkg, const Repository& repo, const fs::path& workDir) {
+    DownloadJob job;
+    job.repo = repo.name;
+    job.output = (workDir / pkg.filename).string();
+    job.displayName = pkg.filename.substr(0, pkg.filename.find(".pkg.tar"));
+    job.size = pkg.compressedSize;
+    job.sha256 = pkg.sha256;
     
-    const PackageInfo& pkg = it->second;
     std::string arch = getSystemArch();
-    std::string pkgFile = (workDir / pkg.filename).string();
-    
-    // Check if package already exists and is valid
-    if (fs::exists(pkgFile) && fs::file_size(pkgFile) > 1000) {
-        std::string testCmd = "file \"" + pkgFile + "\" | grep -q 'Zstandard\\|gzip\\|XZ'";
-        if (std::system(testCmd.c_str()) == 0) {
-            std::cout << GREEN << ":: Package cache hit, using existing file" << RESET << "\n";
-            // Install using pacman
-            std::string installCmd = "sudo pacman -U \"" + pkgFile + "\"";
-            int result = std::system(installCmd.c_str());
-            if (result == 0) {
-                return 1; // Success
-            } else if (WEXITSTATUS(result) == 1) {
-                std::cout << YELLOW << "[*] Installation declined by user" << RESET << "\n";
-                return 2; // User declined
-            } else {
-                std::cerr << RED << "[!] Installation failed" << RESET << "\n";
-                return 0; // Failure
-            }
-        } else {
-            // Remove corrupted file
-            fs::remove(pkgFile);
-        }
-    }
-    
-    // Get servers from Include path or use configured servers
-    std::vector<std::string> servers = repo.servers;
-    if (!repo.includePath.empty()) {
-        // Expand $USER in path
-        std::string expandedPath = repo.includePath;
-        if (expandedPath.find("$USER") != std::string::npos) {
-            std::string user = std::getenv("USER") ? std::getenv("USER") : "";
-            size_t pos = 0;
-            while ((pos = expandedPath.find("$USER", pos)) != std::string::npos) {
-                expandedPath.replace(pos, 5, user);
-                pos += user.length();
-            }
-        }
-        
-        if (fs::exists(expandedPath)) {
-            auto mirrorServers = parseMirrorlist(expandedPath);
-            if (!mirrorServers.empty()) {
-                servers = selectBestMirrors(mirrorServers, repo.name);
-            }
-        }
-    }
-    
-    std::cout << GREEN << ":: Retrieving packages..." << RESET << "\n";
-    
-    for (const auto& serverUrl : servers) {
-        std::string url = replaceRepoVars(serverUrl, repo.name, arch);
-        std::string pkgUrl = url + "/" + pkg.filename;
-        
-        if (downloadWithProgress(pkgUrl, pkgFile, config, pkg.filename)) {
-            // Verify file was downloaded and is valid
-            if (fs::exists(pkgFile) && fs::file_size(pkgFile) > 1000) {
-                // Test if it's a valid archive
-                std::string testCmd = "file \"" + pkgFile + "\" | grep -q 'Zstandard\\|gzip\\|XZ'";
-                if (std::system(testCmd.c_str()) == 0) {
-                    // Install using pacman
-                    std::string installCmd = "sudo pacman -U \"" + pkgFile + "\"";
-                    
-                    int result = std::system(installCmd.c_str());
-                    if (result == 0) {
-                        return 1; // Success
-                    } else if (WEXITSTATUS(result) == 1) {
-                        std::cout << YELLOW << "[*] Installation declined by user" << RESET << "\n";
-                        return 2; // User declined
-                    } else {
-                        std::cerr << RED << "[!] Installation failed" << RESET << "\n";
-                        return 0; // Failure
-                    }
-                } else {
-                    std::cout << RED << "corrupted" << RESET << "\n";
-                    fs::remove(pkgFile);
-                }
-            } else {
-                std::cout << RED << "failed" << RESET << "\n";
-            }
-        } else {
-            // Download failed, already handled by downloadWithProgress
-        }
+    for (const auto& serverUrl : getRepoServers(repo)) {
+        job.mirrors.push_back(serverUrl);
+        job.urls.push_back(replaceRepoVars(serverUrl, repo.name, arch) + "/" + pkg.filename);
     }
-    return 0;
+    return job;
 }
-void removePackageSource(const std::string& pkgName) {
-    fs::path cfgdir = fs::path(std::getenv("HOME")) / ".config" / "tolito";
-    fs::path sourceFile = cfgdir / "package_sources.json";
-    
-    if (!fs::exists(sourceFile)) {
-        return;
-    }
-    
-    // Read existing data
-    std::map<std::string, std::string> sources;
-    std::ifstream in(sourceFile);
-    if (in) {
-        std::string line;
-        bool inObject = false;
-        while (std::getline(in, line)) {
-            if (line.find('{') != std::string::npos) inObject = true;
-            if (line.find('}') != std::string::npos) break;
-            if (inObject) {
-                size_t colon = line.find(':');
-                if (colon != std::string::npos) {
-                    std::string key = line.substr(0, colon);
-                    std::string val = line.substr(colon + 1);
-                    key.erase(std::remove_if(key.begin(), key.end(), [](char c) { return c == '"' || std::isspace(c); }), key.end());
-                    val.erase(std::remove_if(val.begin(), val.end(), [](char c) { return c == '"' || c == ',' || std::isspace(c); }), val.end());
-                    if (!key.empty() && !val.empty()) {
-                        sources[key] = val;
-                    }
+
+// A package resolved in one of the configured repositories
+struct RepoPackage {
+    size_t index;          // Position in the caller's list
+    std::string repoName;
+    std::string pkgFile;
+};
+
+// A package to fetch from the configured repositories
+struct RepoRequest {
+    size_t index;          // Position in the caller's list
+    std::string spec;
+    std::string repoName;  // Only look in this repository; empty = the first that has it
+};
+
+// Look up each wanted package in the configured repositories and download the
+// ones not already in the work directory, all at once. Returns the packages
+// whose file is ready; indexes not found go to 'missing'.
+static std::vector<RepoPackage> fetchRepoPackages(const std::vector<RepoRequest>& wanted, const fs::path& workDir,
+                                                  const Config& config, std::vector<size_t>& missing) {
+    std::vector<RepoPackage> resolved;
+    std::vector<size_t> jobOf;    // Download job per resolved package, NO_JOB on a cache hit
+    std::vector<DownloadJob> jobs;
+    std::map<std::string, size_t> jobOfFile; // A package listed twice shares one download
+    static constexpr size_t NO_JOB = static_cast<size_t>(-1);
+    
+    for (const auto& [index, spec, only] : wanted) {
+        bool found = false;
+        for (const auto& [repoName, repo] : config.repositories) {
+            if (!only.empty() && repoName != only) continue;
+            PackageInfo pkg;
+            if (!findRepoPackage(spec, repo, pkg)) continue;
+            
+            std::string pkgFile = (workDir / pkg.filename).string();
+            auto seen = jobOfFile.find(pkgFile);
+            if (seen == jobOfFile.end()) {
+                std::cout << GREEN << "[*] Found " << spec << " in " << repoName << " repository." << RESET << "\n";
+                bool hit = fs::exists(pkgFile) && isValidPackageFile(pkgFile, pkg);
+                if (!hit) {
+                    std::error_code ec;
+                    fs::remove(pkgFile, ec);
+                    jobs.push_back(makeRepoDownload(pkg, repo, workDir));
                 }
+                seen = jobOfFile.emplace(pkgFile, hit ? NO_JOB : jobs.size() - 1).first;
             }
+            resolved.push_back({index, repoName, pkgFile});
+            jobOf.push_back(seen->second);
+            found = true;
+            break;
         }
-        in.close();
-    }
-    
-    // Remove the entry
-    sources.erase(pkgName);
-    
-    // Write back to file
-    std::ofstream out(sourceFile);
-    if (out) {
-        out << "{\n";
-        for (const auto& [pkg, src] : sources) {
-            out << "  \"" << pkg << "\": \"" << src << "\",\n";
-        }
-        if (!sources.empty()) {
-            out.seekp(-2, std::ios_base::cur);
+        if (!found) {
+            missing.push_back(index);
         }
-        out << "\n}\n";
     }
-}
-static void recordPackageSource(const std::string& pkgName, const std::string& source) {
-    fs::path cfgdir = fs::path(std::getenv("HOME")) / ".config" / "tolito";
-    fs::path sourceFile = cfgdir / "package_sources.json";
     
-    if (!fs::exists(cfgdir)) {
-        fs::create_directories(cfgdir);
+    if (!jobs.empty()) {
+        std::cout << GREEN << ":: Retrieving packages..." << RESET << "\n";
+        runDownloads(jobs, config);
     }
     
-    // Read existing data
-    std::map<std::string, std::string> sources;
-    if (fs::exists(sourceFile)) {
-        std::ifstream in(sourceFile);
-        if (in) {
-            std::string line;
-            bool inObject = false;
-            while (std::getline(in, line)) {
-                // Simple JSON parsing for key-value pairs
-                if (line.find('{') != std::string::npos) inObject = true;
-                if (line.find('}') != std::string::npos) break;
-                if (inObject) {
-                    size_t colon = line.find(':');
-                    if (colon != std::string::npos) {
-                        std::string key = line.substr(0, colon);
-                        std::string val = line.substr(colon + 1);
-                        // Remove quotes and whitespace
-                        key.erase(std::remove_if(key.begin(), key.end(), [](char c) { return c == '"' || std::isspace(c); }), key.end());
-                        val.erase(std::remove_if(val.begin(), val.end(), [](char c) { return c == '"' || c == ',' || std::isspace(c); }), val.end());
-                        if (!key.empty() && !val.empty()) {
-                            sources[key] = val;
-                        }
-                    }
-                }
-            }
-        }
-    }
-    
-    // Update the entry
-    sources[pkgName] = source;
-    
-    // Write back to file
-    std::ofstream out(sourceFile);
-    if (out) {
-        out << "{\n";
-        for (const auto& [pkg, src] : sources) {
-            out << "  \"" << pkg << "\": \"" << src << "\",\n";
+    // Downloads were verified while streaming; a failed job left no file behind
+    std::vector<RepoPackage> ready;
+    for (size_t i = 0; i < resolved.size(); ++i) {
+        if (jobOf[i] == NO_JOB) {
+            std::cout << GREEN << ":: Package cache hit, using existing file" << RESET << "\n";
+        } else if (!jobs[jobOf[i]].ok) {
+            continue;
         }
-        // Remove last comma and close
-        out.seekp(-2, std::ios_base::cur);
-        out << "\n}\n";
+        ready.push_back(resolved[i]);
     }
+    return ready;
 }
 
-// Get package installation source from records
-static std::string getRecordedPackageSource(const std::string& pkgName) {
-    fs::path cfgdir = fs::path(std::getenv("HOME")) / ".config" / "tolito";
-    fs::path sourceFile = cfgdir / "package_sources.json";
-    
-    if (!fs::exists(sourceFile)) {
-        return "Unknown";
-    }
-    
-    std::ifstream in(sourceFile);
-    if (!in) {
-        return "Unknown";
-    }
-    
-    std::string line;
-    bool inObject = false;
-    while (std::getline(in, line)) {
-        if (line.find('{') != std::string::npos) inObject = true;
-        if (line.find('}') != std::string::npos) break;
-        if (inObject) {
-            size_t colon = line.find(':');
-            if (colon != std::string::npos) {
-                std::string key = line.substr(0, colon);
-                std::string val = line.substr(colon + 1);
-                // Remove quotes and whitespace
-                key.erase(std::remove_if(key.begin(), key.end(), [](char c) { return c == '"' || std::isspace(c); }), key.end());
-                val.erase(std::remove_if(val.begin(), val.end(), [](char c) { return c == '"' || c == ',' || std::isspace(c); }), val.end());
-                if (key == pkgName && (val == "AUR" || val == "Curated" || val == "chaotic-aur" || !val.empty())) {
-                    return val;
-                }
-            }
-        }
-    }
-    return "Unknown";
-}
 
-// Check if package is already installed
-static bool isPackageInstalled(const std::string& pkgName) {
-    std::string checkCmd = "pacman -Q " + pkgName + " > /dev/null 2>&1";
-    return std::system(checkCmd.c_str()) == 0;
+// Record for a package just installed by tolito
+static PackageRecord installedRecord(const std::string& name, const std::string& source, const std::string& buildKey = "") {
+    PackageRecord rec;
+    rec.source = source;
+    rec.version = installedVersion(name);
+    rec.buildKey = buildKey;
+    rec.installedAt = static_cast<long long>(std::time(nullptr));
+    return rec;
 }
 
 // Check if package is already installed and get its source
 static std::string getPackageSource(const std::string& pkgName) {
-    if (!isPackageInstalled(pkgName)) {
+    if (!isInstalled(pkgName)) {
         return ""; // Not installed
     }
     
-    std::string source = getRecordedPackageSource(pkgName);
+    PackageRecord rec;
+    std::string source = findPackageRecord(pkgName, rec) ? rec.source : "Unknown";
     if (source == "AUR") {
         return "AUR repositories";
     } else if (source == "Curated") {
@@ -1080,276 +288,522 @@ static std::string getPackageSource(const std::string& pkgName) {
     }
 }
 
-// Install built package with proper user interaction handling
-static int installBuiltPackage(const std::string& expectedPkgName = "") {
-    // Find the built package file
-    std::string findCmd = "ls *.pkg.tar.* 2>/dev/null | head -1";
-    FILE* pipe = popen(findCmd.c_str(), "r");
-    std::string pkgFile;
-    if (pipe) {
-        char buf[256];
-        if (fgets(buf, sizeof(buf), pipe)) {
-            pkgFile = buf;
-            if (!pkgFile.empty() && pkgFile.back() == '\n') {
-                pkgFile.pop_back();
-            }
-        }
-        pclose(pipe);
-    }
-    
-    if (pkgFile.empty()) {
-        std::cerr << RED << "[!] No package file found" << RESET << "\n";
-        return 0; // Failure
-    }
-    
-    // Use expected package name if provided, otherwise extract from filename
-    std::string pkgName = expectedPkgName;
-    if (pkgName.empty()) {
-        pkgName = pkgFile;
-        size_t dashPos = pkgName.find('-');
-        if (dashPos != std::string::npos) {
-            pkgName = pkgName.substr(0, dashPos);
-        }
-    }
+
+// Check that git and makepkg are available (once per run)
+static bool haveBuildTools() {
+    static const bool ok = runCmd("which git > /dev/null", true) == 0 &&
+                           runCmd("which makepkg > /dev/null", true) == 0;
+    return ok;
+}
+
+int installPkg(const std::string &spec, const Config& config) {
+    return installPkgs({spec}, config).front();
+}
+
+// Strip a version constraint ("foo>=1.2" -> "foo")
+static std::string dependencyName(const std::string& dep) {
+    return dep.substr(0, dep.find_first_of("<>="));
+}
+
+// Names from 'deps' that no installed package satisfies (one 'pacman -T' call)
+static std::vector<std::string> unsatisfiedDependencies(const std::vector<std::string>& deps) {
+    std::vector<std::string> missing;
+    if (deps.empty()) return missing;
     
-    // Check if package is already installed
-    if (isPackageInstalled(pkgName)) {
-        std::cout << GREEN << "[✓] Package '" << pkgName << "' is already installed" << RESET << "\n";
-        return 1; // Success (already installed)
+    // Dependency strings come from .SRCINFO files and the AUR: quote every one
+    std::string cmd = "pacman -T --";
+    for (const auto& dep : deps) {
+        cmd += " " + shellQuote(dep);
     }
-    
-    std::string installCmd = "sudo pacman -U " + pkgFile;
-    std::cout << YELLOW << "[~] " << installCmd << RESET << "\n";
-    int installRc = std::system(installCmd.c_str());
-    
-    if (installRc == 0) {
-        return 1; // Success
-    } else {
-        return 2; // Declined
+    FILE* pipe = popen((cmd + " 2>/dev/null").c_str(), "r");
+    if (!pipe) return deps;
+    char buf[256];
+    while (fgets(buf, sizeof(buf), pipe)) {
+        std::string name = buf;
+        name.erase(name.find_last_not_of(" \r\n") + 1);
+        if (!name.empty()) missing.push_back(name);
     }
+    pclose(pipe);
+    return missing;
 }
 
-static int cloneAndBuild(const std::string& url, const std::string& targetDir, const std::string& source = "AUR") {
-    // Check if directory exists and has built packages
-    bool hasBuiltPkg = false;
-    if (fs::exists(targetDir)) {
-        fs::path currentDir = fs::current_path();
-        fs::current_path(targetDir);
-        hasBuiltPkg = isPackageBuilt();
-        fs::current_path(currentDir);
-        
-        if (hasBuiltPkg) {
-            std::cout << YELLOW << "[*] Package already built, skipping clone and build" << RESET << "\n";
+// Packages in pacman's own sync repositories; makepkg -s installs those itself
+static const std::set<std::string>& syncRepoPackages() {
+    static const std::set<std::string> names = [] {
+        std::set<std::string> out;
+        FILE* pipe = popen("pacman -Slq 2>/dev/null", "r");
+        if (!pipe) return out;
+        char buf[256];
+        while (fgets(buf, sizeof(buf), pipe)) {
+            std::string name = buf;
+            name.erase(name.find_last_not_of(" \r\n") + 1);
+            out.insert(name);
         }
-    }
-    
-    if (!hasBuiltPkg) {
-        runCmd("rm -rf " + targetDir, true);
-        std::cout << GREEN << "[*] Cloning " << url << RESET << "\n";
+        pclose(pipe);
+        return out;
+    }();
+    return names;
+}
 
-        if (runCmd("git clone " + url + " " + targetDir) != 0) {
-            std::cerr << RED << "[!] git clone failed\n" << RESET;
-            return 0; // Failure
+// A package that installPkgs builds
+struct PlannedBuild {
+    size_t index;          // Position in the requested specs, or NOT_REQUESTED for dependencies
+    std::string source;    // Recorded in the package source store
+    bool repoFallback;     // Try the configured repositories if the build fails
+};
+static constexpr size_t NOT_REQUESTED = static_cast<size_t>(-1);
+
+// Turn the planned builds into a dependency graph: every curated or AUR node's
+// dependencies that aren't installed and can't come from pacman's sync repos
+// become new curated/AUR nodes, or entries in 'repoDeps' when one of the
+// configured repositories has them. Repeats until no new nodes appear.
+static void resolveDependencies(std::vector<BuildTask>& tasks, std::vector<PlannedBuild>& planned,
+                                std::vector<std::string>& curatedSpecs, std::vector<std::string>& repoDeps,
+                                const fs::path& WORK, const Config& config) {
+    std::map<std::string, size_t> nodeOf;  // Package name -> task
+    std::map<std::string, size_t> baseNode; // AUR package base -> task
+    for (size_t t = 0; t < tasks.size(); ++t) {
+        nodeOf[tasks[t].name] = t;
+    }
+    auto isAurNode = [&](size_t t) {
+        return tasks[t].cloneUrl.rfind(AUR_NS, 0) == 0;
+    };
+    auto addNode = [&](const std::string& name, const std::string& url, const fs::path& dir, const std::string& source) {
+        BuildTask task;
+        task.name = name;
+        task.cloneUrl = url;
+        task.dir = dir.string();
+        tasks.push_back(task);
+        planned.push_back({NOT_REQUESTED, source, false});
+        nodeOf[name] = tasks.size() - 1;
+        return tasks.size() - 1;
+    };
+    
+    std::map<std::string, AURPackage> aurInfo;
+    std::set<std::string> classified;
+    size_t scanned = 0;
+    while (scanned < tasks.size()) {
+        size_t end = tasks.size();
+        
+        // AUR metadata for the requested AUR packages (dependency nodes already have it)
+        std::vector<std::string> query;
+        for (size_t t = scanned; t < end; ++t) {
+            if (isAurNode(t) && !aurInfo.count(tasks[t].name)) query.push_back(tasks[t].name);
+        }
+        for (auto& [name, info] : queryAURInfo(query)) {
+            aurInfo[name] = std::move(info);
         }
-
-        fs::current_path(targetDir);
         
-        // Build the package
-        if (!buildPackage()) {
-            std::cerr << RED << "[!] Build failed" << RESET << "\n";
-            return 0; // Failure
+        // Declared dependencies of the new nodes
+        std::vector<std::pair<size_t, std::string>> edges;
+        std::vector<std::string> unknown;
+        for (size_t t = scanned; t < end; ++t) {
+            std::vector<std::string> deps;
+            if (isAurNode(t)) {
+                auto it = aurInfo.find(tasks[t].name);
+                if (it == aurInfo.end()) continue;
+                const AURPackage& info = it->second;
+                deps = info.depends;
+                deps.insert(deps.end(), info.makeDepends.begin(), info.makeDepends.end());
+                
+                // Split packages are cloned by their package base
+                if (planned[t].index != NOT_REQUESTED && info.packageBase != info.name) {
+                    tasks[t].cloneUrl = std::string(AUR_NS) + info.packageBase + ".git";
+                    tasks[t].dir = (WORK / info.packageBase).string();
+                }
+                baseNode.emplace(info.packageBase, t);
+            } else if (planned[t].source == "Curated") {
+                PackageInfo info;
+                if (findCuratedPackage(tasks[t].name, info)) deps = info.depends;
+            }
+            for (const auto& dep : deps) {
+                std::string name = dependencyName(dep);
+                edges.emplace_back(t, name);
+                if (!nodeOf.count(name) && classified.insert(name).second) {
+                    unknown.push_back(dep);
+                }
+            }
         }
-    } else {
-        fs::current_path(targetDir);
-    }
-    
-    // Install the package
-    fs::path dirPath(targetDir);
-    std::string pkgName = dirPath.filename().string();
-    int installResult = installBuiltPackage(pkgName);
-    if (installResult == 1) {
-        recordPackageSource(pkgName, source);
         
-        if (!hasBuiltPkg) {
-            std::cout << GREEN << "[✓] Package installed successfully!" << RESET << "\n";
+        // Classify what isn't installed yet: curated first, then configured repositories, then AUR
+        std::vector<std::string> aurCandidates;
+        for (const auto& dep : unsatisfiedDependencies(unknown)) {
+            std::string name = dependencyName(dep);
+            if (syncRepoPackages().count(name)) continue;
+            
+            if (curatedPackageExists(name)) {
+                std::cout << GREEN << "[*] Dependency " << name << " found in curated repo." << RESET << "\n";
+                curatedSpecs.push_back(name);
+                addNode(name, "", fs::path(curatedRepoPath()) / name, "Curated");
+                continue;
+            }
+            bool inRepo = false;
+            for (const auto& [repoName, repo] : config.repositories) {
+                if (packageExistsInRepo(name, repo)) {
+                    inRepo = true;
+                    break;
+                }
+            }
+            if (inRepo) {
+                repoDeps.push_back(name);
+            } else {
+                aurCandidates.push_back(name);
+            }
         }
-        return 1; // Success
-    } else if (installResult == 2) {
-        std::cout << YELLOW << "[*] Installation declined by user" << RESET << "\n";
-        return 2; // Declined
-    } else {
-        return 0; // Failure
+        
+        std::vector<std::string> fromAUR;
+        for (auto& [name, info] : queryAURInfo(aurCandidates)) {
+            fromAUR.push_back(name);
+            aurInfo[name] = std::move(info);
+        }
+        if (!fromAUR.empty() && config.askBeforeAUR) {
+            std::cout << YELLOW << "[?] Dependencies from AUR:";
+            for (const auto& name : fromAUR) {
+                std::cout << " " << name;
+            }
+            std::cout << ". Build them? [Y/n] " << RESET << std::flush;
+            std::string resp;
+            std::getline(std::cin, resp);
+            if (!resp.empty() && std::tolower(static_cast<unsigned char>(resp[0])) == 'n') {
+                fromAUR.clear();
+            }
+        }
+        for (const auto& name : fromAUR) {
+            const std::string& base = aurInfo[name].packageBase;
+            auto it = baseNode.find(base);
+            if (it != baseNode.end()) {
+                // Another package of an already planned split package
+                nodeOf[name] = it->second;
+                continue;
+            }
+            baseNode[base] = addNode(name, std::string(AUR_NS) + base + ".git", WORK / base, "AUR");
+        }
+        
+        for (const auto& [t, name] : edges) {
+            auto it = nodeOf.find(name);
+            if (it != nodeOf.end() && it->second != t) {
+                tasks[t].dependsOn.push_back(it->second);
+            }
+        }
+        scanned = end;
     }
 }
 
-int installPkg(const std::string &spec) {
+// Install engine shared by -S and updates. 'sources' holds a preset source per
+// spec ("Curated", "AUR" or a repository name); specs without one go through
+// the usual source selection and are skipped when already installed.
+static std::vector<int> runInstall(const std::vector<std::string>& specs, const std::vector<std::string>& sources,
+                                   const Config& config) {
     static const fs::path WORK = getWorkDir();
-    const std::string workDir = WORK.string();
-    const fs::path originalPath = fs::current_path();
-    Config config = readConfig();
-
-    // Check if package is already installed
-    std::string source = getPackageSource(spec);
-    if (!source.empty()) {
-        std::cout << GREEN << "[✓] Package '" << spec << "' is already installed from " << source << RESET << "\n";
-        return 3; // Already installed (not processed)
-    }
-
-    // 1. Pre-flight (Fixed return)
-    if (runCmd("which git > /dev/null", true) != 0 ||
-        runCmd("which makepkg > /dev/null", true) != 0) {
+    std::vector<int> results(specs.size(), 0); // 0 = failure, 1 = success, 2 = declined AUR, 3 = already installed
+    
+    // 1. Decide the source of every package; all prompts happen here, before any build starts
+    std::vector<PlannedBuild> planned;
+    std::vector<BuildTask> tasks;
+    std::vector<std::string> curatedSpecs;
+    std::vector<RepoRequest> fromRepoSpecs; // Preset to a repository
+    
+    auto planBuild = [&](size_t index, const std::string& name, const std::string& url, const fs::path& dir,
+                         const std::string& source, bool repoFallback) {
+        BuildTask task;
+        task.name = name;
+        task.cloneUrl = url;
+        task.dir = dir.string();
+        tasks.push_back(task);
+        planned.push_back({index, source, repoFallback});
+    };
+    
+    for (size_t i = 0; i < specs.size(); ++i) {
+        const std::string& spec = specs[i];
+        
+        // Source already decided (updates): no prompts, reinstall over the old version
+        const std::string& preset = sources[i];
+        if (!preset.empty() && preset != "Curated" && preset != "AUR") {
+            fromRepoSpecs.push_back({i, spec, preset});
+            continue;
+        }
+        if (!preset.empty() && !haveBuildTools()) {
             std::cerr << RED << "[!] git or makepkg not found\n" << RESET;
-            return 0; // Failure
+            continue; // Failure
         }
-
-    // 2. Direct URL (Fixed return)
-    if (isUrl(spec)) {
-        int success = cloneAndBuild(spec, (WORK / getRepoName(spec)).string());
-        fs::current_path(originalPath);
-        return success;
+        if (preset == "Curated") {
+            curatedSpecs.push_back(spec);
+            planBuild(i, spec, "", fs::path(curatedRepoPath()) / spec, "Curated", false);
+            continue;
+        }
+        if (preset == "AUR") {
+            planBuild(i, spec, std::string(AUR_NS) + spec + ".git", WORK / spec, "AUR", false);
+            continue;
+        }
+        
+        // Check if package is already installed
+        std::string source = getPackageSource(spec);
+        if (!source.empty()) {
+            std::cout << GREEN << "[✓] Package '" << spec << "' is already installed from " << source << RESET << "\n";
+            results[i] = 3; // Already installed (not processed)
+            continue;
+        }
+        
+        if (!haveBuildTools()) {
+            std::cerr << RED << "[!] git or makepkg not found\n" << RESET;
+            continue; // Failure
+        }
+        
+        // Direct URL
+        if (isUrl(spec)) {
+            std::string name = getRepoName(spec);
+            planBuild(i, name, spec, WORK / name, "AUR", false);
+            continue;
+        }
+        
+        // Curated monorepo - checked first
+        if (curatedPackageExists(spec)) {
+            fs::path pkgdir = fs::path(curatedRepoPath()) / spec;
+            std::cout << GREEN << "[*] Found " << spec << " in curated repo." << RESET << "\n";
+            
+            // Check if package also exists in AUR for multi-source handling
+            if (config.askBeforeAUR && packageExistsInAUR(spec) &&
+                handleMultiSourceChoice(spec, WORK, pkgdir) == 1) {
+                planBuild(i, spec, std::string(AUR_NS) + spec + ".git", WORK / spec, "AUR", false);
+                continue;
+            }
+            curatedSpecs.push_back(spec);
+            planBuild(i, spec, "", pkgdir, "Curated", false);
+            continue;
+        }
+        
+        // Fallback to AUR (without a package list, let the clone find out)
+        const RepoIndex& aurIndex = loadAURIndex();
+        if (aurIndex.isOpen() && !aurIndex.contains(spec)) {
+            std::cerr << RED << "[!] '" << spec << "' not found in curated repo or AUR" << RESET << "\n";
+            continue; // Failure
+        }
+        if (config.askBeforeAUR) {
+            std::string prompt = "[?] '" + spec + "' not in curated repo. Try AUR? [Y/n]";
+            if (config.warnAboutAUR) {
+                prompt += " (Unstable sometimes)";
+            }
+            
+            std::cout << YELLOW << prompt << RESET << std::flush;
+            std::string resp;
+            std::getline(std::cin, resp);
+
+            if (!resp.empty()) {
+                char c = std::tolower(static_cast<unsigned char>(resp[0]));
+                if (c == 'n') {
+                    results[i] = 2; // User declined AUR
+                    continue;
+                }
+            }
+        } else if (config.warnAboutAUR) {
+            // Show warning but don't ask, proceed automatically
+            std::cout << YELLOW << "[*] '" << spec << "' not in curated repo. Trying AUR (Unstable sometimes)..." << RESET << "\n";
+        }
+        planBuild(i, spec, std::string(AUR_NS) + spec + ".git", WORK / spec, "AUR", true);
     }
-
-    // 3. Monorepo Logic (Curated) - Check first
-    fs::path monorepoPath = WORK / "viper-pkgbuilds";
-    if (!fs::exists(monorepoPath)) {
-        runCmd("git clone --depth 1 --filter=blob:none --sparse " +
-            std::string(MONOREPO) + " " + monorepoPath.string(), true);
+    
+    // 2. Add curated/AUR/repository dependencies and order the builds
+    std::vector<std::string> repoDeps;
+    resolveDependencies(tasks, planned, curatedSpecs, repoDeps, WORK, config);
+    
+    std::vector<size_t> cyclic;
+    std::vector<std::vector<size_t>> waves = buildWaves(tasks, cyclic);
+    if (!cyclic.empty()) {
+        std::cerr << RED << "[!] Dependency cycle, not building:";
+        for (size_t t : cyclic) {
+            std::cerr << " " << tasks[t].name;
+        }
+        std::cerr << RESET << "\n";
     }
-
-    // Check if sparse-checkout is already initialized
-    std::string checkSparseCmd = "git -C " + monorepoPath.string() + " config core.sparseCheckout";
-    bool sparseInitialized = (std::system((checkSparseCmd + " > /dev/null 2>&1").c_str()) == 0);
     
-    if (!sparseInitialized) {
-        runCmd("git -C " + monorepoPath.string() + " sparse-checkout init --cone", true);
+    // Check out every curated package directory in one go
+    if (!curatedSpecs.empty()) {
+        checkoutCuratedPackages(curatedSpecs);
     }
     
-    // Clean untracked files to avoid sparse-checkout warnings
-    runCmd("git -C " + monorepoPath.string() + " clean -fd > /dev/null 2>&1", true);
-    runCmd("git -C " + monorepoPath.string() + " sparse-checkout set " + spec, true);
-    fs::path pkgdir = monorepoPath / spec;
-
-    if (fs::exists(pkgdir / "PKGBUILD")) {
-        std::cout << GREEN << "[*] Found " << spec << " in curated repo." << RESET << "\n";
-        
-        // Check if package also exists in AUR for multi-source handling
-        if (config.askBeforeAUR && packageExistsInAUR(spec)) {
-            int choice = handleMultiSourceChoice(spec, WORK, pkgdir);
-            
-            if (choice == 1) {
-                // User chose AUR
-                std::string aurUrl = std::string(AUR_NS) + spec + ".git";
-                int success = cloneAndBuild(aurUrl, (WORK / spec).string());
-                fs::current_path(originalPath);
-                return success;
+    // Prebuilt dependencies from the configured repositories go in before any build
+    if (!repoDeps.empty()) {
+        std::vector<RepoRequest> wanted;
+        for (size_t i = 0; i < repoDeps.size(); ++i) {
+            wanted.push_back({i, repoDeps[i], ""});
+        }
+        std::vector<size_t> missing;
+        std::vector<RepoPackage> ready = fetchRepoPackages(wanted, WORK, config, missing);
+        Transaction tx;
+        for (const auto& pkg : ready) {
+            tx.depFiles.push_back(pkg.pkgFile);
+        }
+        if (!tx.depFiles.empty() && commitTransaction(tx) == 1) {
+            std::vector<std::pair<std::string, PackageRecord>> records;
+            for (const auto& pkg : ready) {
+                records.emplace_back(repoDeps[pkg.index], installedRecord(repoDeps[pkg.index], pkg.repoName));
             }
-            // choice == 2 means curated, continue below
+            recordPackages(records);
         }
-        
-        fs::current_path(pkgdir);
-
-        // Check if package is already built
-        if (isPackageBuilt()) {
-            std::cout << YELLOW << "[*] Package already built, skipping build step" << RESET << "\n";
-        } else {
-            // Build the package
-            if (!buildPackage()) {
-                std::cerr << RED << "[!] Failed to build " << spec << " from curated repo." << RESET << "\n";
-                fs::current_path(originalPath);
-                return 0; // Failure
+    }
+    
+    // 3. Build wave by wave; whatever a later wave needs is installed before it starts
+    std::vector<bool> needed(tasks.size(), false);
+    std::vector<bool> installed(tasks.size(), false);
+    for (const auto& task : tasks) {
+        for (size_t dep : task.dependsOn) {
+            needed[dep] = true;
+        }
+    }
+    
+    auto installTasks = [&](const std::vector<size_t>& which) {
+        Transaction tx;
+        for (size_t t : which) {
+            auto& files = (planned[t].index == NOT_REQUESTED) ? tx.depFiles : tx.files;
+            files.insert(files.end(), tasks[t].artifacts.begin(), tasks[t].artifacts.end());
+        }
+        if (tx.files.empty() && tx.depFiles.empty()) return;
+        int rc = commitTransaction(tx);
+        std::vector<std::pair<std::string, PackageRecord>> records;
+        for (size_t t : which) {
+            installed[t] = rc == 1;
+            if (planned[t].index != NOT_REQUESTED) {
+                results[planned[t].index] = rc;
+            }
+            if (rc == 1) {
+                records.emplace_back(tasks[t].name, installedRecord(tasks[t].name, planned[t].source, tasks[t].cacheKey));
+                std::cout << GREEN << "[✓] Installed " << tasks[t].name << " from " << planned[t].source << RESET << "\n";
             }
         }
+        recordPackages(records);
+    };
+    
+    for (size_t w = 0; w < waves.size(); ++w) {
+        std::vector<BuildTask*> batch;
+        for (size_t t : waves[w]) {
+            bool depsReady = std::all_of(tasks[t].dependsOn.begin(), tasks[t].dependsOn.end(),
+                                         [&](size_t dep) { return installed[dep]; });
+            if (depsReady) {
+                batch.push_back(&tasks[t]);
+            } else {
+                std::cerr << RED << "[!] Skipping " << tasks[t].name << ": a dependency failed" << RESET << "\n";
+            }
+        }
+        runBuilds(batch, config);
         
-        // Install the package
-        int installed = installBuiltPackage(spec);
-        fs::current_path(originalPath);
-        
-        if (installed == 1) {
-            recordPackageSource(spec, "Curated");
-            std::cout << GREEN << "[✓] Installed " << spec << " from curated repo." << RESET << "\n";
-            return 1; // Success
-        } else if (installed == 2) {
-            std::cout << YELLOW << "[*] Installation declined by user" << RESET << "\n";
-            return 2; // Declined
-        } else {
-            return 0; // Failure
+        if (w + 1 == waves.size()) break;
+        std::vector<size_t> neededPkgs;
+        for (size_t t : waves[w]) {
+            if (tasks[t].ok && needed[t]) neededPkgs.push_back(t);
         }
+        installTasks(neededPkgs);
     }
-
-    // 4. Fallback to AUR
-    if (config.askBeforeAUR) {
-        std::string prompt = "[?] '" + spec + "' not in curated repo. Try AUR? [Y/n]";
-        if (config.warnAboutAUR) {
-            prompt += " (Unstable sometimes)";
+    
+    // 4. Everything requested that is still pending goes into one final transaction,
+    // with packages preset to a repository and, for failed AUR builds, the configured repositories as a fallback
+    std::vector<size_t> finalPkgs;
+    std::vector<RepoRequest> fallback = fromRepoSpecs;
+    for (size_t t = 0; t < tasks.size(); ++t) {
+        if (planned[t].index == NOT_REQUESTED || installed[t]) continue;
+        if (tasks[t].ok) {
+            finalPkgs.push_back(t);
+        } else if (planned[t].repoFallback) {
+            fallback.push_back({planned[t].index, specs[planned[t].index], ""});
         }
-        
-        std::cout << YELLOW << prompt << RESET << std::flush;
-        std::string resp;
-        std::getline(std::cin, resp);
-
-        if (!resp.empty()) {
-            char c = std::tolower(static_cast<unsigned char>(resp[0]));
-            if (c == 'n') return 2; // User declined AUR
+    }
+    std::vector<RepoPackage> fromRepo;
+    if (!fallback.empty()) {
+        std::vector<size_t> missing;
+        fromRepo = fetchRepoPackages(fallback, WORK, config, missing);
+        for (size_t index : missing) {
+            const std::string& preset = sources[index];
+            std::cerr << RED << "[!] Package '" << specs[index] << "' not found in "
+                      << (preset.empty() ? "any configured repository" : preset + " repository") << RESET << "\n";
         }
-    } else if (config.warnAboutAUR) {
-        // Show warning but don't ask, proceed automatically
-        std::cout << YELLOW << "[*] '" << spec << "' not in curated repo. Trying AUR (Unstable sometimes)..." << RESET << "\n";
     }
-
-    std::string aurUrl = std::string(AUR_NS) + spec + ".git";
-    int success = cloneAndBuild(aurUrl, (WORK / spec).string());
-
-    // 5. If AUR fails, try configured repositories as last resort
-    if (success == 0) {
-        for (const auto& [repoName, repo] : config.repositories) {
-            if (packageExistsInRepo(spec, repo)) {
-                std::cout << GREEN << "[*] Found " << spec << " in " << repoName << " repository." << RESET << "\n";
-                if (downloadFromRepo(spec, repo, WORK, config)) {
-                    recordPackageSource(spec, repoName);
-                    std::cout << GREEN << "[✓] Installed " << spec << " from " << repoName << " repository." << RESET << "\n";
-                    fs::current_path(originalPath);
-                    return 1; // Success
-                }
-            }
+    if (finalPkgs.empty() && fromRepo.empty()) {
+        return results;
+    }
+    
+    Transaction tx;
+    for (size_t t : finalPkgs) {
+        tx.files.insert(tx.files.end(), tasks[t].artifacts.begin(), tasks[t].artifacts.end());
+    }
+    for (const auto& pkg : fromRepo) {
+        tx.files.push_back(pkg.pkgFile);
+    }
+    int rc = commitTransaction(tx);
+    std::vector<std::pair<std::string, PackageRecord>> records;
+    for (size_t t : finalPkgs) {
+        results[planned[t].index] = rc;
+        if (rc == 1) {
+            records.emplace_back(tasks[t].name, installedRecord(tasks[t].name, planned[t].source, tasks[t].cacheKey));
+            std::cout << GREEN << "[✓] Installed " << tasks[t].name << " from " << planned[t].source << RESET << "\n";
+        }
+    }
+    for (const auto& pkg : fromRepo) {
+        results[pkg.index] = rc;
+        if (rc == 1) {
+            records.emplace_back(specs[pkg.index], installedRecord(specs[pkg.index], pkg.repoName));
+            std::cout << GREEN << "[✓] Installed " << specs[pkg.index] << " from " << pkg.repoName << " repository." << RESET << "\n";
         }
     }
+    recordPackages(records);
+    return results;
+}
+
+std::vector<int> installPkgs(const std::vector<std::string>& specs, const Config& config) {
+    return runInstall(specs, std::vector<std::string>(specs.size()), config);
+}
 
-    fs::current_path(originalPath);
-    return success;
+std::vector<int> installTargets(const std::vector<InstallTarget>& targets, const Config& config) {
+    std::vector<std::string> specs, sources;
+    for (const auto& target : targets) {
+        specs.push_back(target.name);
+        sources.push_back(target.source);
+    }
+    return runInstall(specs, sources, config);
 }
 
 // Repository-only installation (for -Sr flag)
-int installPkgFromRepo(const std::string &spec) {
+std::vector<int> installPkgsFromRepo(const std::vector<std::string>& specs, const Config& config) {
     static const fs::path WORK = getWorkDir();
-    const fs::path originalPath = fs::current_path();
-    Config config = readConfig();
-
-    // Check if package is already installed
-    std::string source = getPackageSource(spec);
-    if (!source.empty()) {
-        std::cout << GREEN << "[✓] Package '" << spec << "' is already installed from " << source << RESET << "\n";
-        return 3; // Already installed
+    std::vector<int> results(specs.size(), 0);
+    
+    // Resolve every package first so all downloads can run together
+    std::vector<RepoRequest> wanted;
+    for (size_t i = 0; i < specs.size(); ++i) {
+        const std::string& spec = specs[i];
+        
+        // Check if package is already installed
+        std::string source = getPackageSource(spec);
+        if (!source.empty()) {
+            std::cout << GREEN << "[✓] Package '" << spec << "' is already installed from " << source << RESET << "\n";
+            results[i] = 3; // Already installed
+            continue;
+        }
+        wanted.push_back({i, spec, ""});
     }
-
+    
     // Only check configured repositories
-    for (const auto& [repoName, repo] : config.repositories) {
-        if (packageExistsInRepo(spec, repo)) {
-            std::cout << GREEN << "[*] Found " << spec << " in " << repoName << " repository." << RESET << "\n";
-            int result = downloadFromRepo(spec, repo, WORK, config);
-            fs::current_path(originalPath);
-            
-            if (result == 1) {
-                recordPackageSource(spec, repoName);
-                std::cout << GREEN << "[✓] Installed " << spec << " from " << repoName << " repository." << RESET << "\n";
-                return 1; // Success
-            } else if (result == 2) {
-                return 2; // User declined
-            }
-            // If result == 0, continue to next repo or fail
+    std::vector<size_t> missing;
+    std::vector<RepoPackage> ready = fetchRepoPackages(wanted, WORK, config, missing);
+    for (size_t index : missing) {
+        std::cerr << RED << "[!] Package '" << specs[index] << "' not found in any configured repository" << RESET << "\n";
+        results[index] = 3; // Not found (not a failure)
+    }
+    
+    if (ready.empty()) return results;
+    
+    // One transaction for everything found
+    Transaction tx;
+    for (const auto& pkg : ready) {
+        tx.files.push_back(pkg.pkgFile);
+    }
+    int rc = commitTransaction(tx);
+    std::vector<std::pair<std::string, PackageRecord>> records;
+    for (const auto& pkg : ready) {
+        if (rc == 1) {
+            records.emplace_back(specs[pkg.index], installedRecord(specs[pkg.index], pkg.repoName));
+            std::cout << GREEN << "[✓] Installed " << specs[pkg.index] << " from " << pkg.repoName << " repository." << RESET << "\n";
         }
+        results[pkg.index] = rc;
     }
-
-    std::cerr << RED << "[!] Package '" << spec << "' not found in any configured repository" << RESET << "\n";
-    fs::current_path(originalPath);
-    return 3; // Not found (not a failure)
+    recordPackages(records);
+    return results;
 }
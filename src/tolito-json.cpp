@@ -0,0 +1,211 @@
+#include "tolito-json.h"
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+
+const JsonValue* JsonValue::find(const std::string& key) const {
+    if (type != Type::Object) return nullptr;
+    for (const auto& [k, v] : object) {
+        if (k == key) return &v;
+    }
+    return nullptr;
+}
+
+namespace {
+
+// Deeper documents are rejected instead of risking the stack
+constexpr int MAX_DEPTH = 512;
+
+struct Parser {
+    const std::string& s;
+    size_t pos = 0;
+    int depth = 0;
+
+    void skipSpace() {
+        while (pos < s.size() && std::isspace(static_cast<unsigned char>(s[pos]))) ++pos;
+    }
+
+    bool consume(char c) {
+        skipSpace();
+        if (pos < s.size() && s[pos] == c) {
+            ++pos;
+            return true;
+        }
+        return false;
+    }
+
+    bool literal(const char* word) {
+        size_t len = std::char_traits<char>::length(word);
+        if (s.compare(pos, len, word) != 0) return false;
+        pos += len;
+        return true;
+    }
+
+    static void appendUtf8(std::string& out, unsigned long cp) {
+        if (cp < 0x80) {
+            out += static_cast<char>(cp);
+        } else if (cp < 0x800) {
+            out += static_cast<char>(0xC0 | (cp >> 6));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            out += static_cast<char>(0xE0 | (cp >> 12));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (cp >> 18));
+            out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+    }
+
+    bool hex4(unsigned long& cp) {
+        if (pos + 4 > s.size()) return false;
+        cp = 0;
+        for (size_t i = 0; i < 4; ++i) {
+            char c = s[pos + i];
+            if (!std::isxdigit(static_cast<unsigned char>(c))) return false;
+            cp = cp * 16 + (std::isdigit(static_cast<unsigned char>(c)) ? c - '0' : std::tolower(c) - 'a' + 10);
+        }
+        pos += 4;
+        return true;
+    }
+
+    bool parseString(std::string& out) {
+        if (!consume('"')) return false;
+        while (pos < s.size()) {
+            char c = s[pos++];
+            if (c == '"') return true;
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (pos >= s.size()) return false;
+            switch (s[pos++]) {
+                case '"':  out += '"';  break;
+                case '\\': out += '\\'; break;
+                case '/':  out += '/';  break;
+                case 'b':  out += '\b'; break;
+                case 'f':  out += '\f'; break;
+                case 'n':  out += '\n'; break;
+                case 'r':  out += '\r'; break;
+                case 't':  out += '\t'; break;
+                case 'u': {
+                    unsigned long cp = 0;
+                    if (!hex4(cp)) return false;
+                    // Combine UTF-16 surrogate pairs; an unpaired surrogate is malformed
+                    if (cp >= 0xDC00 && cp <= 0xDFFF) return false;
+                    if (cp >= 0xD800 && cp <= 0xDBFF) {
+                        if (s.compare(pos, 2, "\\u") != 0) return false;
+                        pos += 2;
+                        unsigned long low = 0;
+                        if (!hex4(low) || low < 0xDC00 || low > 0xDFFF) return false;
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    appendUtf8(out, cp);
+                    break;
+                }
+                default:
+                    return false;
+            }
+        }
+        return false;
+    }
+
+    bool parseObject(JsonValue& v) {
+        ++pos;
+        v.type = JsonValue::Type::Object;
+        if (consume('}')) return true;
+        do {
+            std::string key;
+            skipSpace();
+            if (!parseString(key) || !consume(':')) return false;
+            v.object.emplace_back(std::move(key), JsonValue());
+            if (!parseValue(v.object.back().second)) return false;
+        } while (consume(','));
+        return consume('}');
+    }
+
+    bool parseArray(JsonValue& v) {
+        ++pos;
+        v.type = JsonValue::Type::Array;
+        if (consume(']')) return true;
+        do {
+            v.array.emplace_back();
+            if (!parseValue(v.array.back())) return false;
+        } while (consume(','));
+        return consume(']');
+    }
+
+    bool parseValue(JsonValue& v) {
+        skipSpace();
+        if (pos >= s.size()) return false;
+
+        char c = s[pos];
+        if (c == '{' || c == '[') {
+            if (depth >= MAX_DEPTH) return false;
+            ++depth;
+            bool ok = c == '{' ? parseObject(v) : parseArray(v);
+            --depth;
+            return ok;
+        }
+        if (c == '"') {
+            v.type = JsonValue::Type::String;
+            return parseString(v.string);
+        }
+        if (literal("true")) {
+            v.type = JsonValue::Type::Bool;
+            v.boolean = true;
+            return true;
+        }
+        if (literal("false")) {
+            v.type = JsonValue::Type::Bool;
+            return true;
+        }
+        if (literal("null")) {
+            v.type = JsonValue::Type::Null;
+            return true;
+        }
+
+        const char* start = s.c_str() + pos;
+        char* end = nullptr;
+        v.number = std::strtod(start, &end);
+        if (end == start) return false;
+        v.type = JsonValue::Type::Number;
+        pos += end - start;
+        return true;
+    }
+};
+
+} // namespace
+
+bool parseJson(const std::string& text, JsonValue& out) {
+    Parser p{text};
+    out = JsonValue();
+    if (!p.parseValue(out)) return false;
+    p.skipSpace();
+    return p.pos == text.size();
+}
+
+std::string jsonQuote(const std::string& s) {
+    std::string out = "\"";
+    for (char c : s) {
+        switch (c) {
+            case '"':  out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buf[8];
+                    std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    out += buf;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    return out + "\"";
+}
@@ -0,0 +1,112 @@
+#include "tolito-localdb.h"
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+
+namespace fs = std::filesystem;
+
+static std::mutex localDbMutex;
+static std::shared_ptr<const std::map<std::string, LocalPackage>> localDb;
+
+static fs::path localDbPath() {
+    const char* dbPath = std::getenv("TOLITO_DBPATH");
+    return fs::path(dbPath && *dbPath ? dbPath : "/var/lib/pacman") / "local";
+}
+
+// Parse one desc file: "%FIELD%" lines followed by values up to a blank line
+static bool parseLocalDesc(const fs::path& file, LocalPackage& pkg) {
+    std::ifstream in(file);
+    if (!in) return false;
+
+    std::string line, field;
+    while (std::getline(in, line)) {
+        if (line.empty()) {
+            field.clear();
+        } else if (field.empty() && line.size() > 2 && line.front() == '%' && line.back() == '%') {
+            field = line;
+        } else if (field == "%NAME%") {
+            pkg.name = line;
+        } else if (field == "%VERSION%") {
+            pkg.version = line;
+        } else if (field == "%DESC%") {
+            pkg.description = line;
+        } else if (field == "%URL%") {
+            pkg.url = line;
+        } else if (field == "%ARCH%") {
+            pkg.arch = line;
+        } else if (field == "%PACKAGER%") {
+            pkg.packager = line;
+        } else if (field == "%BUILDDATE%") {
+            pkg.buildDate = std::strtoll(line.c_str(), nullptr, 10);
+        } else if (field == "%INSTALLDATE%") {
+            pkg.installDate = std::strtoll(line.c_str(), nullptr, 10);
+        } else if (field == "%SIZE%") {
+            pkg.installedSize = std::strtoull(line.c_str(), nullptr, 10);
+        } else if (field == "%REASON%") {
+            pkg.asDependency = line == "1";
+        } else if (field == "%LICENSE%") {
+            pkg.licenses.push_back(line);
+        } else if (field == "%GROUPS%") {
+            pkg.groups.push_back(line);
+        } else if (field == "%DEPENDS%") {
+            pkg.depends.push_back(line);
+        } else if (field == "%OPTDEPENDS%") {
+            pkg.optDepends.push_back(line);
+        } else if (field == "%PROVIDES%") {
+            pkg.provides.push_back(line);
+        } else if (field == "%CONFLICTS%") {
+            pkg.conflicts.push_back(line);
+        } else if (field == "%REPLACES%") {
+            pkg.replaces.push_back(line);
+        } else if (field == "%VALIDATION%") {
+            pkg.validation.push_back(line);
+        }
+    }
+    return !pkg.name.empty() && !pkg.version.empty();
+}
+
+static std::shared_ptr<const std::map<std::string, LocalPackage>> loadLocalDatabase() {
+    std::lock_guard<std::mutex> lock(localDbMutex);
+    if (localDb) return localDb;
+
+    auto packages = std::make_shared<std::map<std::string, LocalPackage>>();
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(localDbPath(), ec)) {
+        LocalPackage pkg;
+        if (entry.is_directory(ec) && parseLocalDesc(entry.path() / "desc", pkg)) {
+            (*packages)[pkg.name] = std::move(pkg);
+        }
+    }
+    localDb = packages;
+    return localDb;
+}
+
+bool isInstalled(const std::string& name) {
+    return loadLocalDatabase()->count(name) > 0;
+}
+
+std::string installedVersion(const std::string& name) {
+    auto db = loadLocalDatabase();
+    auto it = db->find(name);
+    return it != db->end() ? it->second.version : "";
+}
+
+bool findLocalPackage(const std::string& name, LocalPackage& out) {
+    auto db = loadLocalDatabase();
+    auto it = db->find(name);
+    if (it == db->end()) return false;
+    out = it->second;
+    return true;
+}
+
+std::shared_ptr<const std::map<std::string, LocalPackage>> localPackages() {
+    return loadLocalDatabase();
+}
+
+void invalidateLocalDatabase() {
+    std::lock_guard<std::mutex> lock(localDbMutex);
+    localDb.reset();
+}
@@ -0,0 +1,330 @@
+#include "tolito-mirror.h"
+#include "tolito-repo.h"
+
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdlib>
+#include <ctime>
+#include <sstream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <curl/curl.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+// Stop probing once this many mirrors have answered
+static constexpr size_t PROBE_TOP_MIRRORS = 5;
+
+// Re-probe a repository's mirrors once its ranking is older than this
+static constexpr time_t MIRROR_RANK_TTL = 6 * 60 * 60;
+
+// Assumed time-to-first-byte for mirrors that were never measured
+static constexpr double UNKNOWN_TTFB_MS = 5000;
+
+// Weight of the newest sample in the rolling averages
+static constexpr double EWMA_WEIGHT = 0.3;
+
+// ANSI colors
+static constexpr char YELLOW[] = "\033[33m";
+static constexpr char RESET[]  = "\033[0m";
+
+// Parse mirrorlist file and return servers
+std::vector<std::string> parseMirrorlist(const std::string& path) {
+    std::vector<std::string> servers;
+    std::ifstream file(path);
+    std::string line;
+    
+    while (std::getline(file, line)) {
+        // Remove comments
+        if (auto c = line.find('#'); c != std::string::npos) line.erase(c);
+        
+        // Trim whitespace
+        line.erase(line.begin(), std::find_if(line.begin(), line.end(), [](char c){ return !std::isspace(c); }));
+        line.erase(std::find_if(line.rbegin(), line.rend(), [](char c){ return !std::isspace(c); }).base(), line.end());
+        
+        if (line.empty()) continue;
+        
+        // Look for Server = URL lines
+        if (line.find("Server") == 0) {
+            size_t eq = line.find('=');
+            if (eq != std::string::npos) {
+                std::string url = line.substr(eq + 1);
+                url.erase(url.begin(), std::find_if(url.begin(), url.end(), [](char c){ return !std::isspace(c); }));
+                url.erase(std::find_if(url.rbegin(), url.rend(), [](char c){ return !std::isspace(c); }).base(), url.end());
+                if (!url.empty()) {
+                    servers.push_back(url);
+                }
+            }
+        }
+    }
+    return servers;
+}
+
+// Abort each probe as soon as the first body bytes arrive
+static size_t probeWriteCallback(char* /*ptr*/, size_t size, size_t nmemb, void* userdata) {
+    *static_cast<bool*>(userdata) = size * nmemb > 0;
+    return 0;
+}
+
+// Probe all mirrors concurrently, recording time-to-first-byte (ms) for responders
+// and -1 for mirrors that failed; mirrors still in flight when probing stops are left out.
+// Setting 'cancel' stops probing early.
+static std::map<std::string, double> probeMirrors(const std::vector<std::string>& mirrors, const std::string& repo, const std::string& arch, bool quiet,
+                                                  const std::atomic<bool>* cancel = nullptr) {
+    std::map<std::string, double> results;
+    
+    struct Probe {
+        CURL* handle = nullptr;
+        bool gotData = false;
+        bool done = false;
+        double ttfb = 0;
+    };
+    std::vector<Probe> probes(mirrors.size());
+    std::vector<size_t> responders;
+    
+    CURLM* multi = curl_multi_init();
+    if (!multi) return results;
+    
+    if (!quiet) std::cout << YELLOW << ":: Fetching best mirrors..." << RESET << std::flush;
+    
+    // Race a one-byte ranged request of the database against every mirror
+    std::vector<std::string> urls(mirrors.size());
+    for (size_t i = 0; i < mirrors.size(); ++i) {
+        urls[i] = replaceRepoVars(mirrors[i], repo, arch) + "/" + repo + ".db";
+        CURL* h = curl_easy_init();
+        if (!h) continue;
+        curl_easy_setopt(h, CURLOPT_URL, urls[i].c_str());
+        curl_easy_setopt(h, CURLOPT_RANGE, "0-0");
+        curl_easy_setopt(h, CURLOPT_FOLLOWLOCATION, 1L);
+        curl_easy_setopt(h, CURLOPT_FAILONERROR, 1L);
+        curl_easy_setopt(h, CURLOPT_CONNECTTIMEOUT, 5L);
+        curl_easy_setopt(h, CURLOPT_TIMEOUT, 10L);
+        curl_easy_setopt(h, CURLOPT_WRITEFUNCTION, probeWriteCallback);
+        curl_easy_setopt(h, CURLOPT_WRITEDATA, &probes[i].gotData);
+        curl_easy_setopt(h, CURLOPT_PRIVATE, reinterpret_cast<char*>(i));
+        probes[i].handle = h;
+        curl_multi_add_handle(multi, h);
+    }
+    
+    int running = 1;
+    while (running > 0 && responders.size() < PROBE_TOP_MIRRORS && !(cancel && *cancel)) {
+        curl_multi_perform(multi, &running);
+        
+        int queued;
+        while (CURLMsg* msg = curl_multi_info_read(multi, &queued)) {
+            if (msg->msg != CURLMSG_DONE) continue;
+            
+            char* priv = nullptr;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &priv);
+            Probe& probe = probes[reinterpret_cast<size_t>(priv)];
+            probe.done = true;
+            
+            // Our write callback aborts the transfer, so a write error after data means success
+            CURLcode rc = msg->data.result;
+            if (probe.gotData && (rc == CURLE_OK || rc == CURLE_WRITE_ERROR)) {
+                curl_easy_getinfo(msg->easy_handle, CURLINFO_STARTTRANSFER_TIME, &probe.ttfb);
+                responders.push_back(reinterpret_cast<size_t>(priv));
+            }
+            if (!quiet) std::cout << "." << std::flush;
+        }
+        
+        if (running > 0 && responders.size() < PROBE_TOP_MIRRORS) {
+            curl_multi_poll(multi, nullptr, 0, 100, nullptr);
+        }
+    }
+    
+    for (auto& probe : probes) {
+        if (!probe.handle) continue;
+        curl_multi_remove_handle(multi, probe.handle);
+        curl_easy_cleanup(probe.handle);
+    }
+    curl_multi_cleanup(multi);
+    
+    for (size_t i = 0; i < mirrors.size(); ++i) {
+        if (probes[i].done) results[mirrors[i]] = -1;
+    }
+    for (size_t i : responders) {
+        results[mirrors[i]] = probes[i].ttfb * 1000;
+    }
+    
+    if (!quiet) std::cout << " done" << RESET << "\n";
+    return results;
+}
+
+// Rolling statistics for one mirror
+struct MirrorStats {
+    double ttfbMs = UNKNOWN_TTFB_MS;
+    double bytesPerSec = 0;
+    int failures = 0; // Consecutive failed transfers
+};
+
+// Persistent ranking state for one repository
+struct MirrorRanking {
+    time_t rankedAt = 0;
+    std::map<std::string, MirrorStats> mirrors;
+    bool dirty = false; // Transfers recorded since the last save
+};
+
+static std::mutex rankingMutex;
+static std::map<std::string, MirrorRanking> rankings;
+
+// Cancels and joins a pending background re-rank before the process exits
+struct BackgroundRefresh {
+    std::thread worker;
+    std::atomic<bool> cancel{false};
+    ~BackgroundRefresh() {
+        cancel = true;
+        if (worker.joinable()) worker.join();
+    }
+};
+static std::map<std::string, BackgroundRefresh> refreshes;
+
+static fs::path rankingFile(const std::string& repo) {
+    return fs::path(std::getenv("HOME")) / ".cache" / "tolito" / "mirrors" / repo;
+}
+
+// Load a repository's ranking from ~/.cache/tolito/mirrors/<repo> (caller holds rankingMutex)
+static MirrorRanking& loadRanking(const std::string& repo) {
+    auto it = rankings.find(repo);
+    if (it != rankings.end()) return it->second;
+    
+    MirrorRanking& ranking = rankings[repo];
+    std::ifstream in(rankingFile(repo));
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line.front() == '#') continue;
+        
+        std::istringstream fields(line);
+        if (line.rfind("ranked\t", 0) == 0) {
+            std::string tag;
+            fields >> tag >> ranking.rankedAt;
+            continue;
+        }
+        
+        std::string url;
+        MirrorStats stats;
+        if (std::getline(fields, url, '\t') && fields >> stats.ttfbMs >> stats.bytesPerSec >> stats.failures) {
+            ranking.mirrors[url] = stats;
+        }
+    }
+    return ranking;
+}
+
+// Write a repository's ranking atomically (caller holds rankingMutex)
+static void saveRanking(const std::string& repo, MirrorRanking& ranking) {
+    fs::path file = rankingFile(repo);
+    std::error_code ec;
+    fs::create_directories(file.parent_path(), ec);
+    ranking.dirty = false;
+    
+    // Per-process name so concurrent tolito runs never write the same temp file
+    fs::path tmp = file.string() + ".tmp" + std::to_string(getpid());
+    {
+        std::ofstream out(tmp);
+        if (!out) return;
+        out << "# tolito mirror ranking: url, ttfb ms, bytes/s, consecutive failures\n";
+        out << "ranked\t" << ranking.rankedAt << "\n";
+        for (const auto& [url, stats] : ranking.mirrors) {
+            out << url << "\t" << stats.ttfbMs << "\t" << stats.bytesPerSec << "\t" << stats.failures << "\n";
+        }
+    }
+    fs::rename(tmp, file, ec);
+}
+
+// Fold probe results into the ranking (caller holds rankingMutex)
+static void applyProbe(MirrorRanking& ranking, const std::map<std::string, double>& results) {
+    for (const auto& [url, ttfb] : results) {
+        MirrorStats& stats = ranking.mirrors[url];
+        if (ttfb < 0) {
+            stats.failures++;
+        } else {
+            stats.ttfbMs = ttfb;
+            stats.failures = 0;
+        }
+    }
+    ranking.rankedAt = std::time(nullptr);
+}
+
+// Mirrors that keep failing sink to the bottom; otherwise rank by expected cost
+// of a typical package: latency plus transfer time at the observed throughput
+static double mirrorCost(const MirrorStats& stats) {
+    double cost = stats.ttfbMs;
+    if (stats.bytesPerSec > 0) {
+        cost += 4.0 * 1024 * 1024 / stats.bytesPerSec * 1000;
+    }
+    return cost;
+}
+
+std::vector<std::string> selectBestMirrors(const std::vector<std::string>& mirrors, const std::string& repo, const std::string& arch) {
+    if (mirrors.size() < 2) return mirrors;
+    
+    std::unique_lock<std::mutex> lock(rankingMutex);
+    MirrorRanking& ranking = loadRanking(repo);
+    
+    // A mirror we've never seen (or never ranked at all) means probing now
+    bool unknown = ranking.rankedAt == 0;
+    for (const auto& mirror : mirrors) {
+        if (ranking.mirrors.find(mirror) == ranking.mirrors.end()) unknown = true;
+    }
+    
+    if (unknown) {
+        lock.unlock();
+        auto results = probeMirrors(mirrors, repo, arch, false);
+        lock.lock();
+        applyProbe(ranking, results);
+        for (const auto& mirror : mirrors) ranking.mirrors[mirror];
+        saveRanking(repo, ranking);
+    } else if (std::time(nullptr) - ranking.rankedAt > MIRROR_RANK_TTL && !refreshes[repo].worker.joinable()) {
+        // Stale: keep using the current order and re-rank quietly in the background
+        const std::atomic<bool>* cancel = &refreshes[repo].cancel;
+        refreshes[repo].worker = std::thread([mirrors, repo, arch, cancel]() {
+            auto results = probeMirrors(mirrors, repo, arch, true, cancel);
+            if (*cancel) return; // Exiting; a partial probe is not a ranking
+            std::lock_guard<std::mutex> guard(rankingMutex);
+            MirrorRanking& r = loadRanking(repo);
+            applyProbe(r, results);
+            saveRanking(repo, r);
+        });
+    }
+    
+    std::vector<std::string> sortedMirrors = mirrors;
+    std::stable_sort(sortedMirrors.begin(), sortedMirrors.end(), [&](const std::string& a, const std::string& b) {
+        const MirrorStats& sa = ranking.mirrors[a];
+        const MirrorStats& sb = ranking.mirrors[b];
+        if (sa.failures != sb.failures) return sa.failures < sb.failures;
+        return mirrorCost(sa) < mirrorCost(sb);
+    });
+    return sortedMirrors;
+}
+
+void recordMirrorTransfer(const std::string& repo, const std::string& mirror, bool ok, double bytes, double seconds) {
+    std::lock_guard<std::mutex> lock(rankingMutex);
+    MirrorRanking& ranking = loadRanking(repo);
+    MirrorStats& stats = ranking.mirrors[mirror];
+    
+    if (!ok) {
+        stats.failures++;
+    } else {
+        stats.failures = 0;
+        // Small transfers say more about latency than bandwidth
+        if (bytes >= 64 * 1024 && seconds > 0) {
+            double rate = bytes / seconds;
+            stats.bytesPerSec = stats.bytesPerSec > 0 ? EWMA_WEIGHT * rate + (1 - EWMA_WEIGHT) * stats.bytesPerSec : rate;
+        }
+    }
+    ranking.dirty = true;
+}
+
+void saveMirrorRankings() {
+    std::lock_guard<std::mutex> lock(rankingMutex);
+    for (auto& [repo, ranking] : rankings) {
+        if (ranking.dirty) saveRanking(repo, ranking);
+    }
+}
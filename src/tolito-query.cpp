@@ -1,33 +1,144 @@
 #include "tolito-query.h"
+#include "tolito-localdb.h"
 
 #include <iostream>
-#include <cstdlib>
+#include <cstdio>
+#include <ctime>
 #include <string>
-#include <sys/wait.h>
+#include <vector>
 
-void queryPkg(const std::string& pkg) {
-    std::string cmd = "pacman -Q " + pkg + " 2>/dev/null";
-    int raw = std::system(cmd.c_str());
+// Strip a version constraint or optdepends description ("foo>=1.2", "foo: bar" -> "foo")
+static std::string dependencyName(const std::string& dep) {
+    return dep.substr(0, dep.find_first_of("<>=:"));
+}
 
-    if (raw == -1) {
-        std::cerr << "[!] system() call failed\n";
-        return;
+static std::string joinList(const std::vector<std::string>& items) {
+    if (items.empty()) return "None";
+    std::string out;
+    for (const auto& item : items) {
+        if (!out.empty()) out += "  ";
+        out += item;
     }
-    int exitCode = WEXITSTATUS(raw);
-    if (exitCode != 0) {
-        std::cout << "[!] Package \"" << pkg << "\" is not installed\n";
+    return out;
+}
+
+// Installed size the way pacman prints it ("9.39 MiB")
+static std::string humanSize(unsigned long long bytes) {
+    static constexpr const char* UNITS[] = {"B", "KiB", "MiB", "GiB", "TiB"};
+    double size = static_cast<double>(bytes);
+    int unit = 0;
+    while (size >= 1024 && unit < 4) {
+        size /= 1024;
+        ++unit;
     }
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.2f %s", size, UNITS[unit]);
+    return buf;
+}
+
+static std::string formatDate(long long timestamp) {
+    if (timestamp <= 0) return "None";
+    time_t t = static_cast<time_t>(timestamp);
+    char buf[64];
+    std::strftime(buf, sizeof(buf), "%c", std::localtime(&t));
+    return buf;
+}
+
+static std::string validationName(const std::string& method) {
+    if (method == "pgp") return "Signature";
+    if (method == "sha256") return "SHA-256 Sum";
+    if (method == "md5") return "MD5 Sum";
+    if (method == "none") return "None";
+    return method;
+}
+
+static void printField(const char* label, const std::string& value) {
+    std::printf("%-16s: %s\n", label, value.c_str());
 }
 
-void showInfo(const std::string& pkg) {
-    std::string cmd = "pacman -Qi " + pkg + " 2>/dev/null";
-    int raw = std::system(cmd.c_str());
-    if (raw == -1) {
-        std::cerr << "[!] system() call failed\n";
-        return;
+bool queryPkg(const std::string& pkg) {
+    std::string version = installedVersion(pkg);
+    if (version.empty()) {
+        std::cout << "[!] Package \"" << pkg << "\" is not installed\n";
+        return false;
     }
-    int exitCode = WEXITSTATUS(raw);
-    if (exitCode != 0) {
+    std::cout << pkg << " " << version << "\n";
+    return true;
+}
+
+bool showInfo(const std::string& pkg) {
+    LocalPackage info;
+    if (!findLocalPackage(pkg, info)) {
         std::cout << "[!] No information found for \"" << pkg << "\"\n";
+        return false;
+    }
+
+    // Reverse dependencies, through the package name or anything it provides
+    std::vector<std::string> names = {info.name};
+    for (const auto& provide : info.provides) {
+        names.push_back(dependencyName(provide));
+    }
+    auto satisfies = [&](const std::string& dep) {
+        std::string name = dependencyName(dep);
+        for (const auto& n : names) {
+            if (n == name) return true;
+        }
+        return false;
+    };
+    std::vector<std::string> requiredBy, optionalFor;
+    auto installed = localPackages();
+    for (const auto& [name, other] : *installed) {
+        for (const auto& dep : other.depends) {
+            if (satisfies(dep)) {
+                requiredBy.push_back(name);
+                break;
+            }
+        }
+        for (const auto& dep : other.optDepends) {
+            if (satisfies(dep)) {
+                optionalFor.push_back(name);
+                break;
+            }
+        }
+    }
+
+    std::vector<std::string> validation;
+    for (const auto& method : info.validation) {
+        validation.push_back(validationName(method));
+    }
+
+    printField("Name", info.name);
+    printField("Version", info.version);
+    printField("Description", info.description);
+    printField("Architecture", info.arch);
+    printField("URL", info.url);
+    printField("Licenses", joinList(info.licenses));
+    printField("Groups", joinList(info.groups));
+    printField("Provides", joinList(info.provides));
+    printField("Depends On", joinList(info.depends));
+    if (info.optDepends.empty()) {
+        printField("Optional Deps", "None");
+    } else {
+        for (size_t i = 0; i < info.optDepends.size(); ++i) {
+            const std::string& dep = info.optDepends[i];
+            std::string line = dep + (installed->count(dependencyName(dep)) ? " [installed]" : "");
+            if (i == 0) {
+                printField("Optional Deps", line);
+            } else {
+                std::printf("%-18s%s\n", "", line.c_str());
+            }
+        }
     }
+    printField("Required By", joinList(requiredBy));
+    printField("Optional For", joinList(optionalFor));
+    printField("Conflicts With", joinList(info.conflicts));
+    printField("Replaces", joinList(info.replaces));
+    printField("Installed Size", humanSize(info.installedSize));
+    printField("Packager", info.packager);
+    printField("Build Date", formatDate(info.buildDate));
+    printField("Install Date", formatDate(info.installDate));
+    printField("Install Reason", info.asDependency ? "Installed as a dependency for another package" : "Explicitly installed");
+    printField("Validated By", joinList(validation));
+    std::printf("\n");
+    return true;
 }
@@ -1,38 +1,41 @@
 #include "tolito-remove.h"
-#include "tolito-install.h"
+#include "tolito-transaction.h"
+#include "tolito-localdb.h"
+#include "tolito-sources.h"
 
 #include <iostream>
-#include <cstdlib>
+#include <algorithm>
 #include <string>
-#include <sys/wait.h>
 
 // ANSI colors
 static constexpr char RED[]    = "\033[31m";
 static constexpr char GREEN[]  = "\033[32m";
-static constexpr char YELLOW[] = "\033[33m";
 static constexpr char RESET[]  = "\033[0m";
 
-// Run a shell command; return exit code or -1
-static int runCmd(const std::string& cmd, bool quiet = false) {
-    if (!quiet) std::cout << YELLOW << "[~] " << cmd << RESET << "\n";
-    int r = std::system(cmd.c_str());
-    return (r == -1 ? -1 : WEXITSTATUS(r));
-}
-
-bool removePkg(const std::string& pkg) {
-    if (pkg.empty()) return false;
+std::vector<int> removePkgs(const std::vector<std::string>& pkgs) {
+    std::vector<int> results(pkgs.size(), 0);
 
-    int exitCode = runCmd("sudo pacman -Rns " + pkg);
+    // pacman refuses the whole transaction over one unknown target, so leave those out
+    Transaction tx;
+    for (const auto& pkg : pkgs) {
+        if (isInstalled(pkg)) {
+            tx.removals.push_back(pkg);
+        } else if (!pkg.empty()) {
+            std::cerr << RED << "[!] Package \"" << pkg << "\" is not installed" << RESET << "\n";
+        }
+    }
+    if (tx.removals.empty()) return results;
 
-    if (exitCode == -1) {
-        std::cerr << RED << "[!] system() call failed" << RESET << "\n";
-        return false;
-    } else if (exitCode != 0) {
-        std::cerr << RED << "[!] pacman failed (Code: " << exitCode << ")" << RESET << "\n";
-        return false;
-    } else {
-        std::cout << GREEN << "[✓] Package \"" << pkg << "\" removed successfully" << RESET << "\n";
-        removePackageSource(pkg);
-        return true;
+    int rc = commitTransaction(tx);
+    for (size_t i = 0; i < pkgs.size(); ++i) {
+        if (std::find(tx.removals.begin(), tx.removals.end(), pkgs[i]) == tx.removals.end()) continue;
+        results[i] = rc;
+        if (rc == 1) {
+            std::cout << GREEN << "[✓] Package \"" << pkgs[i] << "\" removed successfully" << RESET << "\n";
+        }
+    }
+    if (rc == 1) {
+        forgetPackages(tx.removals);
     }
+    return results;
 }
@@ -0,0 +1,253 @@
+#include "tolito-repo.h"
+#include "tolito-mirror.h"
+
+#include <iostream>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <chrono>
+#include <strings.h>
+#include <curl/curl.h>
+#include <sys/stat.h>
+#include <sys/utsname.h>
+#include <utime.h>
+
+namespace fs = std::filesystem;
+
+// ANSI colors
+static constexpr char RED[]    = "\033[31m";
+static constexpr char YELLOW[] = "\033[33m";
+static constexpr char RESET[]  = "\033[0m";
+
+// Get system architecture
+std::string getSystemArch() {
+    static const std::string arch = [] {
+        struct utsname u;
+        return (uname(&u) == 0 && u.machine[0]) ? std::string(u.machine) : std::string("x86_64");
+    }();
+    return arch;
+}
+
+// Replace variables in repository URL
+std::string replaceRepoVars(const std::string& url, const std::string& repo, const std::string& arch) {
+    std::string result = url;
+    size_t pos = 0;
+    while ((pos = result.find("$repo", pos)) != std::string::npos) {
+        result.replace(pos, 5, repo);
+        pos += repo.length();
+    }
+    pos = 0;
+    while ((pos = result.find("$arch", pos)) != std::string::npos) {
+        result.replace(pos, 5, arch);
+        pos += arch.length();
+    }
+    return result;
+}
+
+// Resolve servers from the Include'd mirrorlist, falling back to configured Servers
+std::vector<std::string> getRepoServers(const Repository& repo) {
+    std::vector<std::string> servers = repo.servers;
+    if (!repo.includePath.empty()) {
+        // Expand $USER in path
+        std::string expandedPath = repo.includePath;
+        if (expandedPath.find("$USER") != std::string::npos) {
+            std::string user = std::getenv("USER") ? std::getenv("USER") : "";
+            size_t pos = 0;
+            while ((pos = expandedPath.find("$USER", pos)) != std::string::npos) {
+                expandedPath.replace(pos, 5, user);
+                pos += user.length();
+            }
+        }
+        
+        if (fs::exists(expandedPath)) {
+            auto mirrorServers = parseMirrorlist(expandedPath);
+            if (!mirrorServers.empty()) {
+                servers = selectBestMirrors(mirrorServers, repo.name, getSystemArch());
+            }
+        } else {
+            std::cerr << RED << "[!] Mirrorlist not found: " << expandedPath << RESET << "\n";
+        }
+    }
+    return servers;
+}
+
+// Collect the ETag of the final response (redirects reset it)
+static size_t etagHeaderCallback(char* buffer, size_t size, size_t nitems, void* userdata) {
+    auto* etag = static_cast<std::string*>(userdata);
+    std::string line(buffer, size * nitems);
+    
+    if (line.rfind("HTTP/", 0) == 0) {
+        etag->clear();
+    } else if (line.size() > 5 && strncasecmp(line.c_str(), "etag:", 5) == 0) {
+        *etag = line.substr(5);
+        etag->erase(etag->begin(), std::find_if(etag->begin(), etag->end(), [](char c){ return !std::isspace(c); }));
+        etag->erase(std::find_if(etag->rbegin(), etag->rend(), [](char c){ return !std::isspace(c); }).base(), etag->end());
+    }
+    return size * nitems;
+}
+
+int fetchIfModified(const std::string& url, const std::string& file) {
+    std::string etagFile = file + ".etag";
+    std::string partFile = file + ".part";
+    
+    CURL* curl = curl_easy_init();
+    if (!curl) return 0;
+    
+    FILE* fp = fopen(partFile.c_str(), "wb");
+    if (!fp) {
+        curl_easy_cleanup(curl);
+        return 0;
+    }
+    
+    // Validators from the previous download: the stored ETag and the
+    // file's mtime, which holds the server's Last-Modified
+    struct curl_slist* headers = nullptr;
+    struct stat st;
+    if (stat(file.c_str(), &st) == 0 && st.st_size > 0) {
+        std::ifstream in(etagFile);
+        std::string storedEtag;
+        if (std::getline(in, storedEtag) && !storedEtag.empty()) {
+            headers = curl_slist_append(headers, ("If-None-Match: " + storedEtag).c_str());
+        }
+        curl_easy_setopt(curl, CURLOPT_TIMECONDITION, (long)CURL_TIMECOND_IFMODSINCE);
+        curl_easy_setopt(curl, CURLOPT_TIMEVALUE_LARGE, (curl_off_t)st.st_mtime);
+    }
+    
+    std::string etag;
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, fp);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, etagHeaderCallback);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &etag);
+    curl_easy_setopt(curl, CURLOPT_FILETIME, 1L);
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 10L);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 60L);
+    
+    CURLcode res = curl_easy_perform(curl);
+    fclose(fp);
+    
+    long httpCode = 0;
+    long unmet = 0;
+    curl_off_t filetime = -1;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &httpCode);
+    curl_easy_getinfo(curl, CURLINFO_CONDITION_UNMET, &unmet);
+    curl_easy_getinfo(curl, CURLINFO_FILETIME_T, &filetime);
+    curl_slist_free_all(headers);
+    curl_easy_cleanup(curl);
+    
+    if (res != CURLE_OK) {
+        fs::remove(partFile);
+        return 0;
+    }
+    if (httpCode == 304 || unmet) {
+        fs::remove(partFile);
+        return 2;
+    }
+    
+    std::error_code ec;
+    if (fs::file_size(partFile, ec) == 0 || ec) {
+        fs::remove(partFile, ec);
+        return 0;
+    }
+    fs::rename(partFile, file, ec);
+    if (ec) return 0;
+    
+    // Keep the server's timestamp so it can be sent back as If-Modified-Since
+    if (filetime >= 0) {
+        struct utimbuf times = {(time_t)filetime, (time_t)filetime};
+        utime(file.c_str(), &times);
+    }
+    if (!etag.empty()) {
+        std::ofstream(etagFile) << etag << "\n";
+    } else {
+        fs::remove(etagFile, ec);
+    }
+    return 1;
+}
+
+static fs::path repoCacheDir() {
+    return fs::path(std::getenv("HOME")) / ".cache" / "tolito" / "repos";
+}
+
+// Repository indexes opened during this run
+static std::map<std::string, RepoIndex> repoIndexes;
+static std::mutex repoIndexMutex;
+
+// Download the repository database and open its on-disk index
+const RepoIndex& loadRepoIndex(const Repository& repo, bool silent) {
+    std::lock_guard<std::mutex> lock(repoIndexMutex);
+    
+    // Check cache first; each repository is refreshed at most once per run
+    auto cached = repoIndexes.find(repo.name);
+    if (cached != repoIndexes.end()) {
+        return cached->second;
+    }
+    
+    RepoIndex& index = repoIndexes[repo.name];
+    std::string arch = getSystemArch();
+    fs::path cacheDir = repoCacheDir();
+    fs::create_directories(cacheDir);
+    
+    // Databases used to be unpacked here; drop any leftover extraction
+    std::error_code ec;
+    fs::remove_all(cacheDir / repo.name, ec);
+    
+    std::vector<std::string> servers = getRepoServers(repo);
+    
+    std::string dbFile = (cacheDir / (repo.name + ".db")).string();
+    for (const auto& serverUrl : servers) {
+        std::string url = replaceRepoVars(serverUrl, repo.name, arch);
+        std::string dbUrl = url + "/" + repo.name + ".db";
+        
+        // Conditional download; a 304 keeps the existing database and index
+        auto started = std::chrono::steady_clock::now();
+        int fetched = fetchIfModified(dbUrl, dbFile);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - started;
+        recordMirrorTransfer(repo.name, serverUrl, fetched != 0, fetched == 1 ? (double)fs::file_size(dbFile, ec) : 0, elapsed.count());
+        
+        if (fetched != 0) {
+            // Reuse the index if it matches, otherwise parse the database once and rebuild it
+            if (openRepoIndex(dbFile, index)) {
+                break; // Successfully indexed from this server
+            } else if (!silent) {
+                std::cerr << RED << "[!] Failed to read database from " << serverUrl << RESET << "\n";
+            }
+        } else {
+            if (!silent) {
+                std::cerr << RED << "[!] Failed to download database from " << serverUrl << RESET << "\n";
+            }
+        }
+    }
+    saveMirrorRankings();
+    
+    // No server answered: the database from the last run is still better than nothing
+    if (!index.isOpen() && fs::exists(dbFile, ec) && openRepoIndex(dbFile, index) && !silent) {
+        std::cerr << YELLOW << "[*] Using cached " << repo.name << " database" << RESET << "\n";
+    }
+    return index;
+}
+
+std::string repoDatabaseMarker(const Repository& repo) {
+    const RepoIndex& index = loadRepoIndex(repo, true);
+    if (!index.isOpen()) return "";
+    
+    std::ifstream in(repoCacheDir() / (repo.name + ".db.etag"));
+    std::string etag;
+    if (std::getline(in, etag) && !etag.empty()) return etag;
+    return std::string(index.stamp());
+}
+
+bool packageExistsInRepo(const std::string& pkgName, const Repository& repo) {
+    return loadRepoIndex(repo, true).contains(pkgName); // Silent during existence check
+}
+
+bool findRepoPackage(const std::string& pkgName, const Repository& repo, PackageInfo& out) {
+    return loadRepoIndex(repo, true).find(pkgName, out);
+}
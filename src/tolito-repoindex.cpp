@@ -0,0 +1,244 @@
+#include "tolito-repoindex.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static constexpr char INDEX_MAGIC[8] = {'T', 'L', 'T', 'O', 'I', 'D', 'X', '4'};
+
+struct RepoIndexHeader {
+    char magic[8];
+    uint32_t count;
+    uint32_t stampOffset;
+    uint32_t stampLength;
+    uint32_t stringsSize;
+};
+
+struct RepoIndexRecord {
+    uint32_t nameOffset, nameLength;
+    uint32_t versionOffset, versionLength;
+    uint32_t descOffset, descLength;
+    uint32_t filenameOffset, filenameLength;
+    uint32_t dependsOffset, dependsLength; // newline separated
+    uint32_t sha256Offset, sha256Length;
+    uint32_t directoryOffset, directoryLength;
+    uint64_t compressedSize;
+};
+
+RepoIndex::~RepoIndex() {
+    close();
+}
+
+RepoIndex::RepoIndex(RepoIndex&& other) noexcept {
+    *this = std::move(other);
+}
+
+RepoIndex& RepoIndex::operator=(RepoIndex&& other) noexcept {
+    if (this != &other) {
+        close();
+        base_ = other.base_;
+        length_ = other.length_;
+        header_ = other.header_;
+        records_ = other.records_;
+        strings_ = other.strings_;
+        other.base_ = nullptr;
+        other.length_ = 0;
+        other.header_ = nullptr;
+        other.records_ = nullptr;
+        other.strings_ = nullptr;
+    }
+    return *this;
+}
+
+bool RepoIndex::open(const std::string& path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(RepoIndexHeader)) {
+        ::close(fd);
+        return false;
+    }
+
+    void* base = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) return false;
+
+    base_ = base;
+    length_ = st.st_size;
+    header_ = static_cast<const RepoIndexHeader*>(base_);
+
+    // Validate before trusting any offsets
+    size_t recordsEnd = sizeof(RepoIndexHeader) + size_t(header_->count) * sizeof(RepoIndexRecord);
+    if (std::memcmp(header_->magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0 ||
+        recordsEnd + header_->stringsSize != length_ ||
+        size_t(header_->stampOffset) + header_->stampLength > header_->stringsSize) {
+        close();
+        return false;
+    }
+
+    records_ = reinterpret_cast<const RepoIndexRecord*>(static_cast<const char*>(base_) + sizeof(RepoIndexHeader));
+    strings_ = static_cast<const char*>(base_) + recordsEnd;
+    return true;
+}
+
+void RepoIndex::close() {
+    if (base_) {
+        munmap(base_, length_);
+    }
+    base_ = nullptr;
+    length_ = 0;
+    header_ = nullptr;
+    records_ = nullptr;
+    strings_ = nullptr;
+}
+
+std::string_view RepoIndex::str(unsigned offset, unsigned length) const {
+    if (size_t(offset) + length > header_->stringsSize) return {};
+    return std::string_view(strings_ + offset, length);
+}
+
+std::string_view RepoIndex::stamp() const {
+    return isOpen() ? str(header_->stampOffset, header_->stampLength) : std::string_view();
+}
+
+size_t RepoIndex::size() const {
+    return isOpen() ? header_->count : 0;
+}
+
+const RepoIndexRecord* RepoIndex::lookup(std::string_view name) const {
+    if (!isOpen()) return nullptr;
+
+    size_t lo = 0, hi = header_->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int cmp = str(records_[mid].nameOffset, records_[mid].nameLength).compare(name);
+        if (cmp == 0) return &records_[mid];
+        if (cmp < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return nullptr;
+}
+
+bool RepoIndex::contains(std::string_view name) const {
+    return lookup(name) != nullptr;
+}
+
+bool RepoIndex::find(std::string_view name, PackageInfo& out) const {
+    const RepoIndexRecord* rec = lookup(name);
+    if (!rec) return false;
+
+    out = PackageInfo();
+    out.name = str(rec->nameOffset, rec->nameLength);
+    out.version = str(rec->versionOffset, rec->versionLength);
+    out.description = str(rec->descOffset, rec->descLength);
+    out.filename = str(rec->filenameOffset, rec->filenameLength);
+    out.compressedSize = rec->compressedSize;
+    out.sha256 = str(rec->sha256Offset, rec->sha256Length);
+    out.directory = str(rec->directoryOffset, rec->directoryLength);
+
+    std::string_view deps = str(rec->dependsOffset, rec->dependsLength);
+    while (!deps.empty()) {
+        size_t nl = deps.find('\n');
+        out.depends.emplace_back(deps.substr(0, nl));
+        deps.remove_prefix(nl == std::string_view::npos ? deps.size() : nl + 1);
+    }
+    return true;
+}
+
+bool writeRepoIndex(const std::string& path, const std::map<std::string, PackageInfo>& packages, const std::string& stamp) {
+    std::string strings;
+    auto add = [&](std::string_view s, uint32_t& offset, uint32_t& length) {
+        offset = static_cast<uint32_t>(strings.size());
+        length = static_cast<uint32_t>(s.size());
+        strings.append(s);
+    };
+
+    RepoIndexHeader header{};
+    std::memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    header.count = static_cast<uint32_t>(packages.size());
+    add(stamp, header.stampOffset, header.stampLength);
+
+    // std::map iteration order is already sorted by name
+    std::vector<RepoIndexRecord> records;
+    records.reserve(packages.size());
+    for (const auto& [name, pkg] : packages) {
+        RepoIndexRecord rec{};
+        add(name, rec.nameOffset, rec.nameLength);
+        add(pkg.version, rec.versionOffset, rec.versionLength);
+        add(pkg.description, rec.descOffset, rec.descLength);
+        add(pkg.filename, rec.filenameOffset, rec.filenameLength);
+
+        std::string deps;
+        for (const auto& dep : pkg.depends) {
+            if (!deps.empty()) deps += '\n';
+            deps += dep;
+        }
+        add(deps, rec.dependsOffset, rec.dependsLength);
+        add(pkg.sha256, rec.sha256Offset, rec.sha256Length);
+        add(pkg.directory, rec.directoryOffset, rec.directoryLength);
+        rec.compressedSize = pkg.compressedSize;
+        records.push_back(rec);
+    }
+    header.stringsSize = static_cast<uint32_t>(strings.size());
+
+    // Write to a temporary file and rename so readers never see a partial index
+    std::string tmp = path + ".tmp";
+    FILE* fp = fopen(tmp.c_str(), "wb");
+    if (!fp) return false;
+    bool ok = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+              (records.empty() || fwrite(records.data(), sizeof(RepoIndexRecord), records.size(), fp) == records.size()) &&
+              (strings.empty() || fwrite(strings.data(), 1, strings.size(), fp) == strings.size());
+    ok = (fclose(fp) == 0) && ok;
+
+    if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+// The database's size and mtime; downloads keep the server's timestamp
+static std::string databaseStamp(const std::string& dbFile) {
+    std::error_code ec;
+    auto size = fs::file_size(dbFile, ec);
+    if (ec) return "";
+    auto mtime = fs::last_write_time(dbFile, ec);
+    if (ec) return "";
+    return std::to_string(size) + ":" + std::to_string(mtime.time_since_epoch().count());
+}
+
+bool openRepoIndex(const std::string& dbFile, RepoIndex& index) {
+    std::string indexFile = fs::path(dbFile).replace_extension(".idx").string();
+    std::string stamp = databaseStamp(dbFile);
+
+    // Without a database, an existing index is the best we have
+    if (stamp.empty()) {
+        return index.open(indexFile);
+    }
+
+    if (index.open(indexFile) && index.stamp() == stamp) {
+        return true;
+    }
+
+    std::map<std::string, PackageInfo> packages;
+    if (!readSyncDatabase(dbFile, packages) || packages.empty() ||
+        !writeRepoIndex(indexFile, packages, stamp)) {
+        index.close();
+        return false;
+    }
+    return index.open(indexFile);
+}
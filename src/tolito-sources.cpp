@@ -0,0 +1,146 @@
+#include "tolito-sources.h"
+#include "tolito-json.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+using RecordMap = std::map<std::string, PackageRecord>;
+
+static std::mutex storeMutex;
+static std::optional<RecordMap> store;
+
+static fs::path storePath() {
+    const char* home = std::getenv("HOME");
+    return fs::path(home ? home : "/tmp") / ".config" / "tolito" / "package_sources.json";
+}
+
+static std::string stringField(const JsonValue& obj, const char* key) {
+    const JsonValue* v = obj.find(key);
+    return (v && v->type == JsonValue::Type::String) ? v->string : "";
+}
+
+static RecordMap readStore() {
+    RecordMap records;
+    std::ifstream in(storePath());
+    if (!in) return records;
+    std::stringstream text;
+    text << in.rdbuf();
+
+    JsonValue doc;
+    if (!parseJson(text.str(), doc) || doc.type != JsonValue::Type::Object) return records;
+    for (const auto& [name, value] : doc.object) {
+        PackageRecord rec;
+        if (value.type == JsonValue::Type::String) {
+            rec.source = value.string; // Flat format
+        } else if (value.type == JsonValue::Type::Object) {
+            rec.source = stringField(value, "source");
+            rec.version = stringField(value, "version");
+            rec.buildKey = stringField(value, "buildKey");
+            const JsonValue* at = value.find("installedAt");
+            if (at && at->type == JsonValue::Type::Number) rec.installedAt = static_cast<long long>(at->number);
+        }
+        if (!rec.source.empty()) records[name] = std::move(rec);
+    }
+    return records;
+}
+
+static bool writeStore(const RecordMap& records) {
+    std::string out = "{\n";
+    for (auto it = records.begin(); it != records.end(); ++it) {
+        const PackageRecord& rec = it->second;
+        out += "  " + jsonQuote(it->first) + ": {\"source\": " + jsonQuote(rec.source);
+        if (!rec.version.empty()) out += ", \"version\": " + jsonQuote(rec.version);
+        if (!rec.buildKey.empty()) out += ", \"buildKey\": " + jsonQuote(rec.buildKey);
+        if (rec.installedAt > 0) out += ", \"installedAt\": " + std::to_string(rec.installedAt);
+        out += std::next(it) == records.end() ? "}\n" : "},\n";
+    }
+    out += "}\n";
+
+    // Readers only ever see the old or the new file
+    std::string path = storePath().string();
+    std::string tmp = path + ".tmp" + std::to_string(getpid());
+    FILE* fp = fopen(tmp.c_str(), "w");
+    if (!fp) return false;
+    bool ok = fwrite(out.data(), 1, out.size(), fp) == out.size();
+    ok = (fflush(fp) == 0) && ok;
+    ok = (fsync(fileno(fp)) == 0) && ok;
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+static RecordMap& loadedLocked() {
+    if (!store) store = readStore();
+    return *store;
+}
+
+// Re-read the file under an exclusive lock, apply 'mutate' to it and to the
+// in-memory copy, and write it back
+template <typename Mutate>
+static bool applyLocked(Mutate mutate) {
+    mutate(loadedLocked());
+
+    std::error_code ec;
+    fs::create_directories(storePath().parent_path(), ec);
+    std::string lockPath = storePath().string() + ".lock";
+    int fd = open(lockPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+    flock(fd, LOCK_EX);
+
+    RecordMap current = readStore();
+    mutate(current);
+    bool ok = writeStore(current);
+
+    flock(fd, LOCK_UN);
+    close(fd);
+    return ok;
+}
+
+bool findPackageRecord(const std::string& name, PackageRecord& out) {
+    std::lock_guard<std::mutex> lock(storeMutex);
+    const RecordMap& records = loadedLocked();
+    auto it = records.find(name);
+    if (it == records.end()) return false;
+    out = it->second;
+    return true;
+}
+
+std::vector<std::pair<std::string, PackageRecord>> packageRecords() {
+    std::lock_guard<std::mutex> lock(storeMutex);
+    const RecordMap& records = loadedLocked();
+    return {records.begin(), records.end()};
+}
+
+bool recordPackages(const std::vector<std::pair<std::string, PackageRecord>>& records) {
+    if (records.empty()) return true;
+    std::lock_guard<std::mutex> lock(storeMutex);
+    return applyLocked([&](RecordMap& map) {
+        for (const auto& [name, rec] : records) {
+            map[name] = rec;
+        }
+    });
+}
+
+bool forgetPackages(const std::vector<std::string>& names) {
+    if (names.empty()) return true;
+    std::lock_guard<std::mutex> lock(storeMutex);
+    return applyLocked([&](RecordMap& map) {
+        for (const auto& name : names) {
+            map.erase(name);
+        }
+    });
+}
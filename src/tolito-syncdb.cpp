@@ -0,0 +1,191 @@
+#include "tolito-syncdb.h"
+#include "tolito-shell.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <zlib.h>
+
+static constexpr size_t TAR_BLOCK = 512;
+
+PackageInfo parsePackageDesc(std::string_view desc) {
+    PackageInfo pkg;
+    std::string_view currentSection;
+
+    while (!desc.empty()) {
+        size_t nl = desc.find('\n');
+        std::string_view line = desc.substr(0, nl);
+        desc.remove_prefix(nl == std::string_view::npos ? desc.size() : nl + 1);
+
+        if (line.empty()) continue;
+
+        if (line.front() == '%' && line.back() == '%') {
+            currentSection = line.substr(1, line.length() - 2);
+        } else if (currentSection == "NAME") {
+            pkg.name = line;
+        } else if (currentSection == "VERSION") {
+            pkg.version = line;
+        } else if (currentSection == "DESC") {
+            pkg.description = line;
+        } else if (currentSection == "DEPENDS") {
+            pkg.depends.emplace_back(line);
+        } else if (currentSection == "FILENAME") {
+            pkg.filename = line;
+        } else if (currentSection == "CSIZE") {
+            pkg.compressedSize = std::strtoull(std::string(line).c_str(), nullptr, 10);
+        } else if (currentSection == "SHA256SUM") {
+            pkg.sha256 = line;
+        }
+    }
+    return pkg;
+}
+
+// Inflate a gzip stream with zlib
+static bool gunzip(const std::string& in, std::string& out) {
+    z_stream zs{};
+    if (inflateInit2(&zs, 16 + MAX_WBITS) != Z_OK) return false;
+
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+    zs.avail_in = static_cast<uInt>(in.size());
+
+    char buf[64 * 1024];
+    int rc = Z_OK;
+    while (rc != Z_STREAM_END) {
+        zs.next_out = reinterpret_cast<Bytef*>(buf);
+        zs.avail_out = sizeof(buf);
+        rc = inflate(&zs, Z_NO_FLUSH);
+        if (rc != Z_OK && rc != Z_STREAM_END) {
+            inflateEnd(&zs);
+            return false;
+        }
+        out.append(buf, sizeof(buf) - zs.avail_out);
+
+        // Concatenated gzip members
+        if (rc == Z_STREAM_END && zs.avail_in > 0) {
+            inflateReset(&zs);
+            rc = Z_OK;
+        }
+    }
+    inflateEnd(&zs);
+    return true;
+}
+
+// Read the stdout of a decompressor straight into memory
+static bool decompressWith(const std::string& tool, const std::string& file, std::string& out) {
+    std::string cmd = tool + " -dcq -- " + shellQuote(file) + " 2>/dev/null";
+    FILE* pipe = popen(cmd.c_str(), "r");
+    if (!pipe) return false;
+
+    char buf[64 * 1024];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), pipe)) > 0) {
+        out.append(buf, n);
+    }
+    return pclose(pipe) == 0;
+}
+
+// Parse a numeric tar header field (octal, or GNU base-256 for large values)
+static size_t tarNumber(const char* field, size_t len) {
+    if (static_cast<unsigned char>(field[0]) & 0x80) {
+        size_t value = 0;
+        for (size_t i = 1; i < len; ++i) {
+            value = (value << 8) | static_cast<unsigned char>(field[i]);
+        }
+        return value;
+    }
+
+    size_t value = 0;
+    for (size_t i = 0; i < len && field[i]; ++i) {
+        if (field[i] >= '0' && field[i] <= '7') {
+            value = value * 8 + (field[i] - '0');
+        }
+    }
+    return value;
+}
+
+// Extract the "path" record from a pax extended header
+static std::string paxPath(std::string_view records) {
+    while (!records.empty()) {
+        size_t sp = records.find(' ');
+        if (sp == std::string_view::npos) break;
+        size_t len = 0;
+        for (char c : records.substr(0, sp)) len = len * 10 + (c - '0');
+        if (len == 0 || len > records.size()) break;
+
+        std::string_view record = records.substr(sp + 1, len - sp - 2);
+        if (record.compare(0, 5, "path=") == 0) {
+            return std::string(record.substr(5));
+        }
+        records.remove_prefix(len);
+    }
+    return "";
+}
+
+bool readSyncDatabase(const std::string& dbFile, std::map<std::string, PackageInfo>& packages) {
+    std::ifstream in(dbFile, std::ios::binary);
+    if (!in) return false;
+    std::string raw((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    // Detect compression from the magic bytes
+    std::string tar;
+    auto magic = [&](const char* m, size_t n) { return raw.size() >= n && std::memcmp(raw.data(), m, n) == 0; };
+    bool ok = true;
+    if (magic("\x1f\x8b", 2)) {
+        ok = gunzip(raw, tar);
+    } else if (magic("\x28\xb5\x2f\xfd", 4)) {
+        ok = decompressWith("zstd", dbFile, tar);
+    } else if (magic("\xfd" "7zXZ", 5)) {
+        ok = decompressWith("xz", dbFile, tar);
+    } else if (magic("BZh", 3)) {
+        ok = decompressWith("bzip2", dbFile, tar);
+    } else {
+        tar = std::move(raw);
+    }
+    if (!ok) return false;
+
+    // Walk the tar stream: a 512-byte header followed by the data padded to 512 bytes
+    std::string longName;
+    size_t pos = 0;
+    while (pos + TAR_BLOCK <= tar.size()) {
+        const char* hdr = tar.data() + pos;
+        if (hdr[0] == '\0') break; // End-of-archive marker
+
+        size_t size = tarNumber(hdr + 124, 12);
+        char type = hdr[156];
+        size_t dataPos = pos + TAR_BLOCK;
+        if (dataPos + size > tar.size()) return false;
+        std::string_view data(tar.data() + dataPos, size);
+        pos = dataPos + (size + TAR_BLOCK - 1) / TAR_BLOCK * TAR_BLOCK;
+
+        if (type == 'L') {
+            // GNU long name applying to the next entry
+            longName.assign(data.data(), strnlen(data.data(), data.size()));
+            continue;
+        }
+        if (type == 'x') {
+            longName = paxPath(data);
+            continue;
+        }
+
+        std::string name;
+        if (!longName.empty()) {
+            name.swap(longName);
+        } else {
+            name.assign(hdr, strnlen(hdr, 100));
+            // ustar prefix field
+            if (std::memcmp(hdr + 257, "ustar", 5) == 0 && hdr[345]) {
+                name = std::string(hdr + 345, strnlen(hdr + 345, 155)) + "/" + name;
+            }
+        }
+
+        if ((type == '0' || type == '\0') && name.size() > 5 && name.compare(name.size() - 5, 5, "/desc") == 0) {
+            PackageInfo pkg = parsePackageDesc(data);
+            if (!pkg.name.empty()) {
+                packages[pkg.name] = std::move(pkg);
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,80 @@
+#include "tolito-transaction.h"
+#include "tolito-localdb.h"
+#include "tolito-shell.h"
+
+#include <iostream>
+#include <cstdlib>
+#include <filesystem>
+#include <set>
+#include <sys/wait.h>
+
+namespace fs = std::filesystem;
+
+// ANSI colors
+static constexpr char RED[]    = "\033[31m";
+static constexpr char YELLOW[] = "\033[33m";
+static constexpr char RESET[]  = "\033[0m";
+
+std::string packageFileName(const std::string& pkgFile) {
+    std::string name = fs::path(pkgFile).filename().string();
+    name = name.substr(0, name.find(".pkg.tar"));
+    // Drop -arch, -pkgrel and -pkgver
+    for (int i = 0; i < 3; ++i) {
+        size_t dash = name.rfind('-');
+        if (dash == std::string::npos) return "";
+        name.erase(dash);
+    }
+    return name;
+}
+
+// Run a pacman command; returns: 0=failure, 1=success. pacman exits with 1
+// both when the prompt is answered 'n' and on real errors (conflicts,
+// unsatisfied dependencies, corrupt packages), so any other status is a failure.
+static int runPacman(const std::string& cmd, const char* what) {
+    int result = std::system(cmd.c_str());
+    if (result == 0) {
+        return 1;
+    } else if (result == -1) {
+        std::cerr << RED << "[!] system() call failed" << RESET << "\n";
+    } else {
+        std::cerr << RED << "[!] " << what << " failed: pacman exited with code " << WEXITSTATUS(result) << RESET << "\n";
+    }
+    return 0;
+}
+
+int commitTransaction(const Transaction& tx) {
+    // Whatever pacman does from here on changes the installed set
+    invalidateLocalDatabase();
+    if (!tx.removals.empty()) {
+        std::string removeCmd = "sudo pacman -Rns";
+        for (const auto& pkg : tx.removals) {
+            removeCmd += " " + shellQuote(pkg);
+        }
+        int rc = runPacman(removeCmd, "Removal");
+        if (rc != 1) return rc;
+    }
+    if (tx.files.empty() && tx.depFiles.empty()) return 1;
+
+    // Explicit and dependency packages go in together; the install reason
+    // is fixed up afterwards, which only touches the local database
+    // (a package requested twice is passed once)
+    std::string installCmd = "sudo pacman -U";
+    std::set<std::string> passed;
+    for (const auto* list : {&tx.files, &tx.depFiles}) {
+        for (const auto& pkgFile : *list) {
+            if (passed.insert(pkgFile).second) installCmd += " " + shellQuote(pkgFile);
+        }
+    }
+    int rc = runPacman(installCmd, "Installation");
+    if (rc != 1 || tx.depFiles.empty()) return rc;
+
+    std::string markCmd = "sudo pacman -D --asdeps";
+    for (const auto& pkgFile : tx.depFiles) {
+        markCmd += " " + shellQuote(packageFileName(pkgFile));
+    }
+    markCmd += " >/dev/null";
+    if (std::system(markCmd.c_str()) != 0) {
+        std::cerr << YELLOW << "[*] Could not set the install reason of dependencies" << RESET << "\n";
+    }
+    return 1;
+}
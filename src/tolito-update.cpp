@@ -1,14 +1,23 @@
 #include "tolito-update.h"
 #include "tolito-install.h"
+#include "tolito-aur.h"
+#include "tolito-vercmp.h"
+#include "tolito-repo.h"
+#include "tolito-curated.h"
+#include "tolito-localdb.h"
+#include "tolito-sources.h"
 
-#include <iostream>
+#include <cstdlib>
 #include <filesystem>
 #include <fstream>
+#include <iostream>
 #include <map>
 #include <vector>
 #include <algorithm>
 #include <sstream>
 #include <regex>
+#include <thread>
+#include <atomic>
 
 namespace fs = std::filesystem;
 
@@ -18,218 +27,147 @@ static constexpr char GREEN[]  = "\033[32m";
 static constexpr char YELLOW[] = "\033[33m";
 static constexpr char RESET[]  = "\033[0m";
 
-// Get installed packages with their sources
+// Packages tolito installed, with their recorded sources
 static std::map<std::string, std::string> getInstalledPackages() {
     std::map<std::string, std::string> packages;
-    fs::path cfgdir = fs::path(std::getenv("HOME")) / ".config" / "tolito";
-    fs::path sourceFile = cfgdir / "package_sources.json";
-    
-    if (!fs::exists(sourceFile)) {
-        return packages;
-    }
-    
-    std::ifstream in(sourceFile);
-    if (!in) {
-        return packages;
-    }
-    
-    std::string line;
-    bool inObject = false;
-    while (std::getline(in, line)) {
-        if (line.find('{') != std::string::npos) inObject = true;
-        if (line.find('}') != std::string::npos) break;
-        if (inObject) {
-            size_t colon = line.find(':');
-            if (colon != std::string::npos) {
-                std::string key = line.substr(0, colon);
-                std::string val = line.substr(colon + 1);
-                // Remove quotes and whitespace
-                key.erase(std::remove_if(key.begin(), key.end(), [](char c) { return c == '"' || std::isspace(c); }), key.end());
-                val.erase(std::remove_if(val.begin(), val.end(), [](char c) { return c == '"' || c == ',' || std::isspace(c); }), val.end());
-                if (!key.empty() && !val.empty()) {
-                    packages[key] = val;
-                }
-            }
-        }
+    for (const auto& [name, rec] : packageRecords()) {
+        packages[name] = rec.source;
     }
     return packages;
 }
 
-// Get current version of installed package
-static std::string getCurrentVersion(const std::string& pkgName) {
-    std::string cmd = "pacman -Q " + pkgName + " 2>/dev/null | awk '{print $2}'";
-    FILE* pipe = popen(cmd.c_str(), "r");
-    if (!pipe) return "";
+// Get version from repository (Chaotic)
+static std::string getRepoVersion(const std::string& pkgName, const std::string& repoName, const Config& config) {
+    auto repo = config.repositories.find(repoName);
+    if (repo == config.repositories.end()) return "";
     
-    char buffer[256];
-    std::string result = "";
-    if (fgets(buffer, sizeof(buffer), pipe)) {
-        result = buffer;
-        if (!result.empty() && result.back() == '\n') {
-            result.pop_back();
-        }
-    }
-    pclose(pipe);
-    return result;
+    PackageInfo pkg;
+    return findRepoPackage(pkgName, repo->second, pkg) ? pkg.version : "";
 }
 
-// Compare versions (simplified version comparison)
-static int compareVersions(const std::string& v1, const std::string& v2) {
-    if (v1 == v2) return 0;
-    
-    // Use vercmp if available
-    std::string cmd = "vercmp '" + v1 + "' '" + v2 + "' 2>/dev/null";
-    FILE* pipe = popen(cmd.c_str(), "r");
-    if (pipe) {
-        char result[16];
-        if (fgets(result, sizeof(result), pipe)) {
-            int cmp = std::atoi(result);
-            pclose(pipe);
-            return cmp;
-        }
-        pclose(pipe);
-    }
+// Look up the UpdateRules entry (e.g. _CURATED_) for a recorded package source
+static const UpdateRule* findUpdateRule(const Config& config, const std::string& source) {
+    std::string ruleKey = "_" + source + "_";
+    std::transform(ruleKey.begin(), ruleKey.end(), ruleKey.begin(), ::toupper);
     
-    // Fallback to string comparison
-    return v1 < v2 ? -1 : 1;
+    auto it = config.updateRules.find(ruleKey);
+    return it != config.updateRules.end() ? &it->second : nullptr;
 }
 
-// Get version from AUR
-static std::string getAURVersion(const std::string& pkgName) {
-    std::string cmd = "curl -s 'https://aur.archlinux.org/rpc/?v=5&type=info&arg=" + pkgName + "' | grep -o '\"Version\":\"[^\"]*\"' | cut -d'\"' -f4";
-    FILE* pipe = popen(cmd.c_str(), "r");
-    if (!pipe) return "";
-    
-    char buffer[256];
-    std::string result = "";
-    if (fgets(buffer, sizeof(buffer), pipe)) {
-        result = buffer;
-        if (!result.empty() && result.back() == '\n') {
-            result.pop_back();
-        }
-    }
-    pclose(pipe);
-    return result;
+// Upstream version of a package at one source, and the marker it was read at
+struct UpstreamState {
+    std::string marker;
+    std::string version;
+};
+
+// (package, source) -> last observed upstream state
+using UpstreamStates = std::map<std::pair<std::string, std::string>, UpstreamState>;
+
+static fs::path upstreamStatePath() {
+    const char* home = std::getenv("HOME");
+    return fs::path(home ? home : "/tmp") / ".cache" / "tolito" / "upstream";
 }
 
-// Get version from curated repo
-static std::string getCuratedVersion(const std::string& pkgName) {
-    std::string homeDir = std::string(std::getenv("HOME"));
-    std::string monorepoPath = homeDir + "/tolito/viper-pkgbuilds";
-    std::string workDir = monorepoPath + "/" + pkgName;
-    
-    // Ensure monorepo exists and is updated
-    if (!std::filesystem::exists(monorepoPath)) {
-        std::string cloneCmd = "git clone --depth 1 --filter=blob:none --sparse https://github.com/Xray-OS/viper-pkgbuilds " + monorepoPath + " >/dev/null 2>&1";
-        if (std::system(cloneCmd.c_str()) != 0) {
-            return "";
+// "<package>\t<source>\t<marker>\t<version>" per line; a missing or damaged
+// file only means everything is resolved again
+static UpstreamStates readUpstreamStates() {
+    UpstreamStates states;
+    std::ifstream in(upstreamStatePath());
+    std::string line;
+    while (std::getline(in, line)) {
+        std::vector<std::string> fields;
+        std::istringstream fieldStream(line);
+        std::string field;
+        while (std::getline(fieldStream, field, '\t')) {
+            fields.push_back(field);
         }
+        if (fields.size() != 4 || fields[2].empty()) continue;
+        states[{fields[0], fields[1]}] = {fields[2], fields[3]};
     }
-    
-    // Update repository and set sparse-checkout
-    std::string updateCmd = "cd '" + monorepoPath + "' && git pull >/dev/null 2>&1 && git sparse-checkout init --cone >/dev/null 2>&1 && git sparse-checkout set " + pkgName + " >/dev/null 2>&1";
-    std::system(updateCmd.c_str());
-    
-    if (!std::filesystem::exists(workDir + "/PKGBUILD")) {
-        return "";
-    }
-    
-    std::string cmd = "cd '" + workDir + "' && bash -c 'source PKGBUILD && echo $pkgver-$pkgrel' 2>/dev/null";
-    FILE* pipe = popen(cmd.c_str(), "r");
-    if (!pipe) return "";
-    
-    char buffer[256];
-    std::string result = "";
-    if (fgets(buffer, sizeof(buffer), pipe)) {
-        result = buffer;
-        if (!result.empty() && result.back() == '\n') {
-            result.pop_back();
+    return states;
+}
+
+static void writeUpstreamStates(const UpstreamStates& states) {
+    fs::path path = upstreamStatePath();
+    fs::path tmp = path.string() + ".tmp";
+    std::error_code ec;
+    fs::create_directories(path.parent_path(), ec);
+    {
+        std::ofstream out(tmp);
+        for (const auto& [key, state] : states) {
+            out << key.first << "\t" << key.second << "\t" << state.marker << "\t" << state.version << "\n";
         }
+        if (!out) return;
     }
-    pclose(pipe);
-    return result;
+    fs::rename(tmp, path, ec);
 }
 
-// Get version from repository (Chaotic)
-static std::string getRepoVersion(const std::string& pkgName, const std::string& repoName) {
-    std::string cacheDir = std::string(std::getenv("HOME")) + "/.cache/tolito/repos/" + repoName;
-    std::string cmd = "find '" + cacheDir + "' -name 'desc' -exec grep -l '^" + pkgName + "$' {} \\; | head -1 | xargs dirname | xargs -I {} cat {}/desc | awk '/^%VERSION%/{getline; print; exit}'";
-    
-    FILE* pipe = popen(cmd.c_str(), "r");
-    if (!pipe) return "";
-    
-    char buffer[256];
-    std::string result = "";
-    if (fgets(buffer, sizeof(buffer), pipe)) {
-        result = buffer;
-        if (!result.empty() && result.back() == '\n') {
-            result.pop_back();
-        }
+// Everything the checks read from upstream, gathered before they start
+struct UpstreamSnapshot {
+    std::map<std::string, AURPackage> aurInfo;
+    bool curatedRefreshed = false;
+    UpstreamStates known;
+};
+
+// What identifies the package's upstream copy at 'source' right now; the
+// version is only resolved again when this differs from the stored marker
+static std::string upstreamMarker(const std::string& pkgName, const std::string& source,
+                                  const Config& config, const UpstreamSnapshot& upstream) {
+    if (source == "CURATED") {
+        return upstream.curatedRefreshed ? curatedPackageTree(pkgName) : "";
+    } else if (source == "AUR") {
+        auto it = upstream.aurInfo.find(pkgName);
+        return it != upstream.aurInfo.end() ? std::to_string(it->second.lastModified) : "";
+    } else if (source == "CHAOTIC") {
+        auto repo = config.repositories.find("chaotic-aur");
+        return repo != config.repositories.end() ? repoDatabaseMarker(repo->second) : "";
     }
-    pclose(pipe);
-    return result;
+    return "";
 }
 
-// Read configuration (simplified version for update module)
-static std::map<std::string, std::map<std::string, std::string>> readUpdateRules() {
-    std::map<std::string, std::map<std::string, std::string>> rules;
-    std::filesystem::path conf = std::filesystem::path(std::getenv("HOME")) / ".config" / "tolito" / "tolito.conf";
-    
-    if (!std::filesystem::exists(conf)) return rules;
-    
-    std::ifstream in(conf);
-    std::string line, currentSection, currentRule;
-    
-    while (std::getline(in, line)) {
-        if (auto c = line.find('#'); c != std::string::npos) line.erase(c);
-        line.erase(line.begin(), std::find_if(line.begin(), line.end(), [](char c){ return !std::isspace(c); }));
-        line.erase(std::find_if(line.rbegin(), line.rend(), [](char c){ return !std::isspace(c); }).base(), line.end());
-        
-        if (line.empty()) continue;
-        
-        if (line.front() == '[' && line.back() == ']') {
-            currentSection = line.substr(1, line.length() - 2);
-            currentRule = "";
-        } else if (line.back() == ':' && currentSection == "UpdateRules") {
-            currentRule = line.substr(0, line.length() - 1);
-        } else if (auto eq = line.find('='); eq != std::string::npos && !currentRule.empty()) {
-            std::string key = line.substr(0, eq);
-            std::string val = line.substr(eq + 1);
-            key.erase(key.begin(), std::find_if(key.begin(), key.end(), [](char c){ return !std::isspace(c); }));
-            key.erase(std::find_if(key.rbegin(), key.rend(), [](char c){ return !std::isspace(c); }).base(), key.end());
-            val.erase(val.begin(), std::find_if(val.begin(), val.end(), [](char c){ return !std::isspace(c); }));
-            val.erase(std::find_if(val.rbegin(), val.rend(), [](char c){ return !std::isspace(c); }).base(), val.end());
-            rules[currentRule][key] = val;
-        }
+static std::string resolveUpstreamVersion(const std::string& pkgName, const std::string& source,
+                                          const Config& config, const UpstreamSnapshot& upstream) {
+    if (source == "CURATED") {
+        PackageInfo pkg;
+        if (upstream.curatedRefreshed && findCuratedPackage(pkgName, pkg)) return pkg.version;
+    } else if (source == "AUR") {
+        auto it = upstream.aurInfo.find(pkgName);
+        if (it != upstream.aurInfo.end()) return it->second.version;
+    } else if (source == "CHAOTIC") {
+        return getRepoVersion(pkgName, "chaotic-aur", config);
     }
-    return rules;
+    return "";
 }
 
-// Check for updates using priority rules
-static std::string checkUpdateWithPriority(const std::string& pkgName, const std::string& currentSource, const std::string& currentVersion) {
-    auto updateRules = readUpdateRules();
-    std::string ruleKey = "_" + currentSource + "_";
-    std::transform(ruleKey.begin(), ruleKey.end(), ruleKey.begin(), ::toupper);
-    
-    if (updateRules.find(ruleKey) == updateRules.end()) {
-        return ""; // No rules for this source
+// Check for updates using priority rules; fills 'update' if a rule source has a newer version.
+// Sources whose marker matches the stored one reuse the stored version; the
+// states observed for this package are appended to 'observed'.
+static bool checkUpdateWithPriority(const std::string& pkgName, const std::string& currentSource, const std::string& currentVersion,
+                                    const Config& config, const UpstreamSnapshot& upstream,
+                                    std::vector<std::pair<std::string, UpstreamState>>& observed, PackageUpdate& update) {
+    const UpdateRule* rule = findUpdateRule(config, currentSource);
+    if (!rule) {
+        return false; // No rules for this source
     }
     
-    auto& rule = updateRules[ruleKey];
-    std::vector<std::string> sources = {rule["main"], rule["alternative"], rule["fallback"]};
+    std::vector<std::string> sources = {rule->main, rule->alternative, rule->fallback};
     
     std::string bestVersion = currentVersion;
     std::string bestSource = currentSource;
     
     for (const auto& source : sources) {
+        if (source.empty()) continue;
+        std::string marker = upstreamMarker(pkgName, source, config, upstream);
         std::string version;
         
-        if (source == "CURATED") {
-            version = getCuratedVersion(pkgName);
-        } else if (source == "AUR") {
-            version = getAURVersion(pkgName);
-        } else if (source == "CHAOTIC") {
-            version = getRepoVersion(pkgName, "chaotic-aur");
+        auto known = upstream.known.find({pkgName, source});
+        if (!marker.empty() && known != upstream.known.end() && known->second.marker == marker) {
+            version = known->second.version;
+        } else {
+            version = resolveUpstreamVersion(pkgName, source, config, upstream);
+        }
+        if (!marker.empty()) {
+            observed.push_back({source, {marker, version}});
         }
         
         if (!version.empty() && compareVersions(bestVersion, version) < 0) {
@@ -238,32 +176,151 @@ static std::string checkUpdateWithPriority(const std::string& pkgName, const std
         }
     }
     
-    return bestVersion != currentVersion ? bestVersion + " (from " + bestSource + ")" : "";
+    if (bestVersion == currentVersion) return false;
+    update.name = pkgName;
+    update.currentVersion = currentVersion;
+    update.newVersion = bestVersion;
+    update.source = bestSource;
+    return true;
 }
-std::vector<std::string> checkUpdates() {
-    std::vector<std::string> updatesAvailable;
+
+// Install source for an update rule source
+static std::string installSource(const std::string& ruleSource) {
+    if (ruleSource == "CURATED") return "Curated";
+    if (ruleSource == "CHAOTIC") return "chaotic-aur";
+    return ruleSource;
+}
+
+std::string describeUpdate(const PackageUpdate& update) {
+    return update.name + " " + update.currentVersion + " -> " + update.newVersion + " (from " + update.source + ")";
+}
+
+// Fetch AUR metadata up front for every package whose rules consult the AUR
+static std::map<std::string, AURPackage> prefetchAURInfo(const std::vector<std::pair<std::string, std::string>>& packages, const Config& config) {
+    std::vector<std::string> names;
+    
+    for (const auto& [pkgName, source] : packages) {
+        const UpdateRule* rule = findUpdateRule(config, source);
+        if (!rule) continue;
+        
+        if (rule->main == "AUR" || rule->alternative == "AUR" || rule->fallback == "AUR") {
+            names.push_back(pkgName);
+        }
+    }
+    return queryAURInfo(names);
+}
+
+// Fetch the curated monorepo once if any package's rules consult it
+static bool prefetchCurated(const std::vector<std::pair<std::string, std::string>>& packages, const Config& config) {
+    for (const auto& [pkgName, source] : packages) {
+        const UpdateRule* rule = findUpdateRule(config, source);
+        if (!rule) continue;
+        
+        if (rule->main == "CURATED" || rule->alternative == "CURATED" || rule->fallback == "CURATED") {
+            return refreshCuratedRepo();
+        }
+    }
+    return false;
+}
+
+// One network round per source: the batched AUR query, the curated fetch
+// and the conditional repository downloads
+static UpstreamSnapshot snapshotUpstream(const std::vector<std::pair<std::string, std::string>>& packages, const Config& config) {
+    UpstreamSnapshot upstream;
+    upstream.aurInfo = prefetchAURInfo(packages, config);
+    upstream.curatedRefreshed = prefetchCurated(packages, config);
+    upstream.known = readUpstreamStates();
+    
+    // Refresh repository indexes before the workers start sharing them
+    for (const auto& [repoName, repo] : config.repositories) {
+        loadRepoIndex(repo, true);
+    }
+    return upstream;
+}
+
+std::vector<PackageUpdate> checkUpdates(const Config& config) {
+    std::vector<PackageUpdate> updatesAvailable;
     auto installedPackages = getInstalledPackages();
+    std::vector<std::pair<std::string, std::string>> work(installedPackages.begin(), installedPackages.end());
     
     std::cout << YELLOW << "[*] Checking for updates..." << RESET << "\n";
     
-    for (const auto& [pkgName, source] : installedPackages) {
-        std::string currentVersion = getCurrentVersion(pkgName);
-        if (currentVersion.empty()) continue;
-        
-        // Check for updates based on priority rules
-        std::string updateInfo = checkUpdateWithPriority(pkgName, source, currentVersion);
-        if (!updateInfo.empty()) {
-            updatesAvailable.push_back(pkgName + " " + currentVersion + " -> " + updateInfo);
+    UpstreamSnapshot upstream = snapshotUpstream(work, config);
+    
+    // Each worker claims the next package index and writes into its own slot,
+    // so the merged result keeps the order of the records regardless of timing
+    std::vector<PackageUpdate> results(work.size());
+    std::vector<std::vector<std::pair<std::string, UpstreamState>>> observed(work.size());
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t i = next++; i < work.size(); i = next++) {
+            const auto& [pkgName, source] = work[i];
+            std::string currentVersion = installedVersion(pkgName);
+            if (currentVersion.empty()) continue;
+            
+            // Check for updates based on priority rules
+            checkUpdateWithPriority(pkgName, source, currentVersion, config, upstream, observed[i], results[i]);
         }
+    };
+    
+    size_t jobs = std::min<size_t>(config.parallelUpdateChecks, work.size());
+    std::vector<std::thread> pool;
+    for (size_t t = 1; t < jobs; ++t) {
+        pool.emplace_back(worker);
     }
+    worker();
+    for (auto& th : pool) {
+        th.join();
+    }
+    
+    for (auto& result : results) {
+        if (!result.name.empty()) {
+            updatesAvailable.push_back(std::move(result));
+        }
+    }
+    
+    // Keep only what was seen for packages still tracked
+    UpstreamStates states;
+    for (size_t i = 0; i < work.size(); ++i) {
+        for (auto& [source, state] : observed[i]) {
+            states[{work[i].first, source}] = std::move(state);
+        }
+    }
+    writeUpstreamStates(states);
     
     return updatesAvailable;
 }
 
-int updatePkg(const std::string& spec) {
+void applyUpdates(std::vector<PackageUpdate>& updates, const Config& config) {
+    std::vector<InstallTarget> targets;
+    for (const auto& update : updates) {
+        targets.push_back({update.name, installSource(update.source)});
+    }
+    std::vector<int> results = installTargets(targets, config);
+    for (size_t i = 0; i < updates.size(); ++i) {
+        updates[i].result = results[i];
+    }
+}
+
+// Print what happened to each update; returns the number applied
+static size_t reportUpdates(const std::vector<PackageUpdate>& updates) {
+    size_t applied = 0;
+    std::cout << "\n";
+    for (const auto& update : updates) {
+        if (update.result == 1) {
+            ++applied;
+            std::cout << GREEN << "[✓] " << describeUpdate(update) << RESET << "\n";
+        } else {
+            std::cout << RED << "[!] " << update.name << ": update failed" << RESET << "\n";
+        }
+    }
+    return applied;
+}
+
+int updatePkg(const Config& config, const std::string& spec) {
     if (spec.empty()) {
         // Update all packages
-        auto updates = checkUpdates();
+        auto updates = checkUpdates(config);
         if (updates.empty()) {
             std::cout << GREEN << "[✓] All packages are up to date" << RESET << "\n";
             return 1;
@@ -271,7 +328,7 @@ int updatePkg(const std::string& spec) {
         
         std::cout << YELLOW << "Updates available:" << RESET << "\n";
         for (const auto& update : updates) {
-            std::cout << "  " << update << "\n";
+            std::cout << "  " << describeUpdate(update) << "\n";
         }
         
         std::cout << YELLOW << "\nProceed with updates? [Y/n] " << RESET << std::flush;
@@ -283,19 +340,9 @@ int updatePkg(const std::string& spec) {
             return 2;
         }
         
-        // Perform updates
-        int successCount = 0;
-        for (const auto& update : updates) {
-            std::string pkgName = update.substr(0, update.find(' '));
-            std::cout << YELLOW << "\n[*] Updating " << pkgName << "..." << RESET << "\n";
-            
-            // Use installPkg to handle the update (it will reinstall with newer version)
-            // This leverages all existing logic for source detection and building
-            std::string installCmd = "./tolito -S " + pkgName;
-            if (std::system(installCmd.c_str()) == 0) {
-                successCount++;
-            }
-        }
+        // Everything goes through one install run: shared indexes, builds and a single transaction
+        applyUpdates(updates, config);
+        size_t successCount = reportUpdates(updates);
         
         std::cout << GREEN << "\n[✓] Updated " << successCount << "/" << updates.size() << " packages" << RESET << "\n";
         return successCount > 0 ? 1 : 0;
@@ -310,16 +357,29 @@ int updatePkg(const std::string& spec) {
             return 0;
         }
         
-        std::string currentVersion = getCurrentVersion(spec);
+        std::string currentVersion = installedVersion(spec);
         std::string source = installedPackages[spec];
         
-        std::string updateInfo = checkUpdateWithPriority(spec, source, currentVersion);
-        if (updateInfo.empty()) {
+        UpstreamSnapshot upstream = snapshotUpstream({{spec, source}}, config);
+        std::vector<std::pair<std::string, UpstreamState>> observed;
+        std::vector<PackageUpdate> updates(1);
+        bool found = checkUpdateWithPriority(spec, source, currentVersion, config, upstream, observed, updates[0]);
+        
+        UpstreamStates states = std::move(upstream.known);
+        for (auto it = states.begin(); it != states.end();) {
+            it = it->first.first == spec ? states.erase(it) : std::next(it);
+        }
+        for (auto& [observedSource, state] : observed) {
+            states[{spec, observedSource}] = std::move(state);
+        }
+        writeUpstreamStates(states);
+        
+        if (!found) {
             std::cout << GREEN << "[✓] " << spec << " is up to date" << RESET << "\n";
             return 1;
         }
         
-        std::cout << YELLOW << "Update available: " << spec << " " << currentVersion << " -> " << updateInfo << RESET << "\n";
+        std::cout << YELLOW << "Update available: " << describeUpdate(updates[0]) << RESET << "\n";
         std::cout << YELLOW << "Proceed with update? [Y/n] " << RESET << std::flush;
         
         std::string resp;
@@ -331,7 +391,8 @@ int updatePkg(const std::string& spec) {
         }
         
         // Perform update
-        std::string installCmd = "./tolito -S " + spec;
-        return std::system(installCmd.c_str()) == 0 ? 1 : 0;
+        applyUpdates(updates, config);
+        reportUpdates(updates);
+        return updates[0].result;
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,171 @@
+// Test of compareVersions(): checks pacman's own vercmp cases against their
+// known results, then, when vercmp is installed, compares the two over a
+// generated corpus of versions.
+//
+// Usage: vercmp_test [pairs] [seed]
+
+#include "tolito-vercmp.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+// Versions pacman's own test suite (test/util/vercmptest.sh) checks, with the
+// sign vercmp gives for a vs b; each pair is also checked reversed
+struct KnownPair {
+    const char* a;
+    const char* b;
+    int expected;
+};
+
+static const KnownPair KNOWN_PAIRS[] = {
+    {"1.5.0", "1.5.0", 0}, {"1.5.1", "1.5.0", 1}, {"1.5.1", "1.5", 1}, {"1.5.0-1", "1.5.0-1", 0},
+    {"1.5.0-1", "1.5.0-2", -1}, {"1.5.0-1", "1.5.1-1", -1}, {"1.5.0-2", "1.5.1-1", -1}, {"1.5-1", "1.5", 0},
+    {"1.5-1", "1.5-1", 0}, {"1.5-1", "1.5-2", -1}, {"1.5.1-1", "1.5", 1}, {"1.1-1", "1.1", 0},
+    {"1.1-1", "1.1-1", 0}, {"1.1-1", "1.1-2", -1}, {"1.0", "1.0", 0}, {"1.0a", "1.0", -1}, {"1.0a", "1.0b", -1},
+    {"1.0b", "1.0beta", -1}, {"1.0beta", "1.0p", -1}, {"1.0p", "1.0pre", -1}, {"1.0pre", "1.0rc", -1},
+    {"1.0rc", "1.0", -1}, {"1.0", "1.0.a", -1}, {"1.0.a", "1.0.1", -1}, {"1", "1.0", -1}, {"1.0", "1.0.1", -1},
+    {"1.0.1", "1.1", -1}, {"1.0.0", "1.0", 1}, {"1.0.2", "1.0.1", 1}, {"1.5b-1", "1.5-1", -1}, {"1.5b", "1.5", -1},
+    {"1.5b-1", "1.5", -1}, {"1.5b", "1.5.1", -1}, {"1.0-1", "1.0-1.1", -1}, {"1.1", "1.1-1.1", 0},
+    {"1.1.1-1", "1.1-1.1", 1}, {"0:1.0", "0:1.0", 0}, {"0:1.0", "0:1.1", -1}, {"1:1.0", "0:1.0", 1},
+    {"1:1.0", "0:1.1", 1}, {"1:1.1", "2:1.1", -1}, {"0:1.0", "1.0", 0}, {"0:1.0", "1.1", -1}, {"1:1.0", "1.0", 1},
+    {"1:1.0", "1.1", 1}, {"1:1.1", "1.2", 1}, {"1.1", "1.1..1", -1}, {"1.1a", "1.1..a", -1},
+    {"1.1...1", "1.1..1", 1}, {"1.1.1", "1.1..1", -1}, {"1.1+1", "1.1.1", 0}, {"1.1~1", "1.1.1", 0},
+    {"1.1~1", "1.1+1", 0}, {"1.0rc1", "1.0", -1}, {"1.0", "1.0rc1.1", 1}, {"1.0.0rc1", "1.0.0.1", -1},
+    {"20240101", "1.0", 1}, {"r123.abcdef", "r124.aaaaaa", -1}, {"", "", 0}, {"", "1", -1}, {"1.", "1", 1},
+};
+
+// Random version built from the pieces real versions are made of: epochs,
+// numbers with leading zeros, letters, mixed separators and pkgrels
+static std::string randomVersion(std::mt19937& rng) {
+    static const char* const WORDS[] = {"a", "b", "alpha", "beta", "pre", "rc", "p", "git", "r", "svn", "z"};
+    static const char SEPARATORS[] = {'.', '.', '.', '_', '+', '~', '.'};
+    auto pick = [&](size_t n) { return static_cast<size_t>(rng() % n); };
+
+    std::string v;
+    if (pick(5) == 0) v += std::to_string(pick(3)) + ":";
+
+    size_t segments = 1 + pick(4);
+    for (size_t i = 0; i < segments; ++i) {
+        if (i > 0) {
+            v += SEPARATORS[pick(sizeof(SEPARATORS))];
+            if (pick(10) == 0) v += '.'; // Repeated separators
+        }
+        switch (pick(6)) {
+        case 0:
+            v += WORDS[pick(sizeof(WORDS) / sizeof(WORDS[0]))];
+            break;
+        case 1:
+            v += std::to_string(pick(3)) + WORDS[pick(sizeof(WORDS) / sizeof(WORDS[0]))] + std::to_string(pick(3));
+            break;
+        case 2:
+            v += std::string(pick(3), '0') + std::to_string(pick(12));
+            break;
+        default:
+            v += std::to_string(pick(4) == 0 ? rng() : pick(12));
+            break;
+        }
+    }
+    if (pick(3) != 0) {
+        v += "-" + std::to_string(1 + pick(3));
+        if (pick(6) == 0) v += "." + std::to_string(pick(3));
+    }
+    return v;
+}
+
+static bool haveVercmp() {
+    return std::system("command -v vercmp >/dev/null 2>&1") == 0;
+}
+
+// Run vercmp over every pair with a single shell loop; one result per pair
+static std::vector<int> runVercmp(const std::vector<std::pair<std::string, std::string>>& pairs) {
+    std::vector<int> results;
+    char tmpl[] = "/tmp/tolito-vercmp-XXXXXX";
+    int fd = mkstemp(tmpl);
+    if (fd < 0) return results;
+    FILE* out = fdopen(fd, "w");
+    for (const auto& [a, b] : pairs) {
+        fprintf(out, "%s\x1f%s\n", a.c_str(), b.c_str());
+    }
+    fclose(out);
+
+    // A non-whitespace separator, so read keeps empty fields
+    std::string cmd = std::string("while IFS='\x1f' read -r a b; do vercmp \"$a\" \"$b\"; done < ") + tmpl;
+    FILE* pipe = popen(cmd.c_str(), "r");
+    if (pipe) {
+        char buf[64];
+        while (fgets(buf, sizeof(buf), pipe)) {
+            results.push_back(std::atoi(buf));
+        }
+        pclose(pipe);
+    }
+    std::remove(tmpl);
+    return results;
+}
+
+static int sign(int x) {
+    return (x > 0) - (x < 0);
+}
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+    unsigned seed = argc > 2 ? static_cast<unsigned>(std::strtoul(argv[2], nullptr, 10)) : 20240101u;
+
+    size_t failures = 0;
+    for (const auto& known : KNOWN_PAIRS) {
+        int forward = sign(compareVersions(known.a, known.b));
+        int backward = sign(compareVersions(known.b, known.a));
+        if (forward != known.expected || backward != -known.expected) {
+            ++failures;
+            fprintf(stderr, "vercmp_test: '%s' vs '%s': compareVersions=%d/%d expected=%d/%d\n", known.a, known.b,
+                    forward, backward, known.expected, -known.expected);
+        }
+    }
+    printf("vercmp_test: %zu known pairs, %zu mismatches\n", sizeof(KNOWN_PAIRS) / sizeof(KNOWN_PAIRS[0]), failures);
+    if (failures > 0) return 1;
+
+    if (!haveVercmp()) {
+        printf("vercmp_test: differential corpus SKIP (vercmp not installed)\n");
+        return 0;
+    }
+
+    std::vector<std::pair<std::string, std::string>> pairs;
+    for (const auto& known : KNOWN_PAIRS) {
+        pairs.emplace_back(known.a, known.b);
+        pairs.emplace_back(known.b, known.a);
+    }
+    std::mt19937 rng(seed);
+    while (pairs.size() < count) {
+        std::string a = randomVersion(rng);
+        // Half of the pairs are near-misses of each other, which is where bugs hide
+        std::string b = (rng() % 2) ? randomVersion(rng) : a;
+        if (b == a && !a.empty()) {
+            size_t pos = rng() % a.size();
+            static const char EDITS[] = "0123456789ab.-_~+:";
+            b[pos] = EDITS[rng() % (sizeof(EDITS) - 1)];
+        }
+        pairs.emplace_back(a, b);
+    }
+
+    std::vector<int> expected = runVercmp(pairs);
+    if (expected.size() != pairs.size()) {
+        fprintf(stderr, "vercmp_test: got %zu results from vercmp for %zu pairs\n", expected.size(), pairs.size());
+        return 1;
+    }
+
+    for (size_t i = 0; i < pairs.size(); ++i) {
+        int got = sign(compareVersions(pairs[i].first, pairs[i].second));
+        if (got != sign(expected[i])) {
+            if (++failures <= 20) {
+                fprintf(stderr, "vercmp_test: '%s' vs '%s': compareVersions=%d vercmp=%d\n",
+                        pairs[i].first.c_str(), pairs[i].second.c_str(), got, expected[i]);
+            }
+        }
+    }
+    printf("vercmp_test: %zu pairs, %zu mismatches (seed %u)\n", pairs.size(), failures, seed);
+    return failures == 0 ? 0 : 1;
+}